@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    ConnectionSolverBenchmark.cpp
+    Created: 19 Oct 2026 10:31:45pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "ConnectionSolverBenchmark.h"
+
+ConnectionSolverBenchmark::ConnectionSolverBenchmark (int fs) : fs (fs)
+{
+}
+
+String ConnectionSolverBenchmark::run()
+{
+    String csv = "type,overlapping,connections,overlap groups,solveInteractions (us/sample),solveOverlappingConnections (us/sample),resetOverlappingConnectionVectors (us/call)\n";
+    String report = "Connection solver benchmark at " + String (fs) + " Hz\n";
+#ifndef USE_EIGEN
+    report << "USE_EIGEN is not defined: overlapping connections are not solved\n";
+#endif
+    
+    std::vector<ConnectionType> connectionTypes {rigid, linearSpring, nonlinearSpring};
+    for (auto connectionType : connectionTypes)
+    {
+        for (int overlapping = 0; overlapping < 2; ++overlapping)
+        {
+            double baseline = 0.0;
+            for (int m = 0; m < Global::numConnectionBenchmarkSizes; ++m)
+            {
+                int numConnections = Global::connectionBenchmarkNumConnections[m];
+                // solveOverlappingConnections is measured in isolation on a fresh instrument so that the connections are not solved twice per sample
+                Result result = measure (createInstrument (connectionType, numConnections, overlapping == 1), false);
+                result.solveOverlappingTime = measure (createInstrument (connectionType, numConnections, overlapping == 1), true).solveOverlappingTime;
+                if (m == 0)
+                    baseline = result.solveInteractionsTime;
+                
+                csv << getConnectionTypeString (connectionType) << "," << overlapping << "," << numConnections << "," << result.numOverlapGroups << ","
+                    << String (result.solveInteractionsTime, 4) << "," << String (result.solveOverlappingTime, 4) << "," << String (result.resetOverlappingTime, 4) << "\n";
+                
+                report << getConnectionTypeString (connectionType) << (overlapping == 1 ? " (overlapping)" : "") << ", " << numConnections << " connections: "
+                       << "solveInteractions " << String (result.solveInteractionsTime, 4) << " us/sample"
+                       << " (" << String (result.solveInteractionsTime / std::max (baseline, 1e-9) / numConnections, 2) << "x per connection compared to 1 connection)"
+                       << ", solveOverlappingConnections " << String (result.solveOverlappingTime, 4) << " us/sample"
+                       << " (" << String (result.numOverlapGroups) << " groups)"
+                       << ", resetOverlappingConnectionVectors " << String (result.resetOverlappingTime, 2) << " us\n";
+            }
+        }
+    }
+    
+    std::cout << report << std::endl;
+    return csv;
+}
+
+std::shared_ptr<Instrument> ConnectionSolverBenchmark::createInstrument (ConnectionType connectionType, int numConnections, bool overlapping)
+{
+    std::shared_ptr<Instrument> instrument = std::make_shared<Instrument> (fs);
+    InOutInfo inOutInfo (false);
+    
+    // all grid points that can be connected to, as {module, location}. Strings are added until every connection has its own points
+    size_t numPointsNeeded = overlapping ? numConnections + 1 : 2 * numConnections;
+    std::vector<std::pair<int, int>> points;
+    for (int k = 0; k < Global::connectionBenchmarkNumModules || points.size() < numPointsNeeded; ++k)
+    {
+        instrument->addResonatorModule (stiffString, Global::defaultStringParametersAdvanced, inOutInfo, true);
+        int N = instrument->getResonatorPtr (k)->getNumIntervals();
+        for (int l = 3; l <= N - 3; ++l)
+            points.push_back ({k, l});
+    }
+    // interleave the modules so that consecutive points are on different modules
+    std::sort (points.begin(), points.end(), [] (const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.second == b.second ? a.first < b.first : a.second < b.second;
+    });
+    
+    for (int c = 0; c < numConnections; ++c)
+    {
+        // separate points for every connection, or a chain where every connection shares its first point with the second point of the previous one
+        std::pair<int, int> from = points[overlapping ? c : 2 * c];
+        std::pair<int, int> to = points[overlapping ? c + 1 : 2 * c + 1];
+        
+        instrument->addFirstConnection (instrument->getResonatorPtr (from.first), connectionType, from.second);
+        instrument->addSecondConnection (instrument->getResonatorPtr (to.first), to.second);
+        instrument->setCurrentlyActiveConnection (nullptr);
+        instrument->setAction (noAction);
+    }
+    
+    // excite all modules so that the (nonlinear) connections have something to do
+    for (int k = 0; k < instrument->getNumResonatorModules(); ++k)
+        instrument->getResonatorPtr (k)->triggerRaisedCos();
+    instrument->checkIfShouldExciteRaisedCos();
+    
+    return instrument;
+}
+
+ConnectionSolverBenchmark::Result ConnectionSolverBenchmark::measure (std::shared_ptr<Instrument> instrument, bool overlappingOnly)
+{
+    Result result;
+    juce::ScopedNoDenormals noDenormals;
+    
+    int64 resetTicks = 0;
+    for (int i = 0; i < Global::connectionBenchmarkNumResets; ++i)
+    {
+        int64 startTicks = Time::getHighResolutionTicks();
+        instrument->resetOverlappingConnectionVectors();
+        resetTicks += Time::getHighResolutionTicks() - startTicks;
+    }
+    result.resetOverlappingTime = 1e6 * Time::highResolutionTicksToSeconds (resetTicks) / Global::connectionBenchmarkNumResets;
+    
+    auto& overlappingConnections = instrument->getOverlappingConnections();
+    result.numOverlapGroups = static_cast<int> (overlappingConnections.size());
+    
+    int numSamples = static_cast<int> (Global::connectionBenchmarkLength * fs);
+    int64 solveTicks = 0;
+    int64 overlapTicks = 0;
+    for (int n = 0; n < numSamples; ++n)
+    {
+        instrument->calculate();
+        
+        int64 startTicks = Time::getHighResolutionTicks();
+        if (overlappingOnly)
+        {
+            for (auto& group : overlappingConnections)
+                instrument->solveOverlappingConnections (group);
+            overlapTicks += Time::getHighResolutionTicks() - startTicks;
+        }
+        else
+        {
+            instrument->solveInteractions();
+            solveTicks += Time::getHighResolutionTicks() - startTicks;
+        }
+        
+        instrument->update();
+    }
+    result.solveInteractionsTime = 1e6 * Time::highResolutionTicksToSeconds (solveTicks) / numSamples;
+    result.solveOverlappingTime = 1e6 * Time::highResolutionTicksToSeconds (overlapTicks) / numSamples;
+    return result;
+}
+
+String ConnectionSolverBenchmark::getConnectionTypeString (ConnectionType connectionType)
+{
+    switch (connectionType)
+    {
+        case rigid:
+            return "rigid";
+        case linearSpring:
+            return "linear";
+        case nonlinearSpring:
+            return "nonlinear";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    ConnectionSolverBenchmark.h
+    Created: 19 Oct 2026 10:31:45pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/Global.h"
+#include "../../Source/Instrument.h"
+
+/*  Measures how the connection path scales with the number of connections (part of ModularVSTBenchmarks).
+ 
+    For every connection type, synthetic instruments with strings and an increasing number of connections (Global::connectionBenchmarkNumConnections) are built, either with every connection at its own pair of grid points or chained so that every connection overlaps with the previous one. Strings are added to the minimum of Global::connectionBenchmarkNumModules until there are enough points. Per configuration, the per-sample cost of solveInteractions and solveOverlappingConnections and the cost of resetOverlappingConnectionVectors are measured. The results are returned as CSV.
+ 
+    Overlapping connections are only solved when USE_EIGEN is defined. Without it, solveOverlappingConnections does nothing and overlapping connections are skipped by solveInteractions.
+ */
+class ConnectionSolverBenchmark
+{
+public:
+    ConnectionSolverBenchmark (int fs);
+    ~ConnectionSolverBenchmark() {};
+    
+    String run(); // returns the results as CSV
+    
+private:
+    struct Result
+    {
+        double solveInteractionsTime = 0.0; // per sample, in µs
+        double solveOverlappingTime = 0.0; // per sample, in µs
+        double resetOverlappingTime = 0.0; // per call, in µs
+        int numOverlapGroups = 0;
+    };
+    
+    std::shared_ptr<Instrument> createInstrument (ConnectionType connectionType, int numConnections, bool overlapping);
+    Result measure (std::shared_ptr<Instrument> instrument, bool overlappingOnly);
+    
+    static String getConnectionTypeString (ConnectionType connectionType);
+    
+    int fs;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConnectionSolverBenchmark)
+};
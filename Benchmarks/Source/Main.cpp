@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 10:31:45pm
+    Author:  Silvin Willemsen
+
+    Runs the ModularVST benchmarks without a host (build the Release
+    configuration):
+ 
+        ModularVSTBenchmarks [--output <file.csv>]                 connection solver scaling (CSV)
+        ModularVSTBenchmarks --stress-test [--output <folder>]    capacity with randomised instruments
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ConnectionSolverBenchmark.h"
+#include "StressTest.h"
+
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser; // the resonator modules are components
+    ArgumentList args (argc, argv);
+    
+    if (args.containsOption ("--stress-test"))
+    {
+        File outputFolder = args.containsOption ("--output") ? args.getFileForOption ("--output")
+                                                              : File::getCurrentWorkingDirectory().getChildFile ("StressTest_" + Time::getCurrentTime().formatted ("%Y-%m-%d_%H-%M-%S"));
+        StressTest stressTest (Global::stressTestSampleRate, outputFolder);
+        stressTest.run();
+        return 0;
+    }
+    
+    ConnectionSolverBenchmark connectionSolverBenchmark (Global::connectionBenchmarkSampleRate);
+    String csv = connectionSolverBenchmark.run();
+    
+    File csvFile = args.containsOption ("--output") ? args.getFileForOption ("--output")
+                                                     : File::getCurrentWorkingDirectory().getChildFile ("ConnectionSolverBenchmark_" + String (Global::connectionBenchmarkSampleRate) + ".csv");
+    if (!csvFile.replaceWithText (csv))
+    {
+        std::cout << "Could not write " << csvFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    return 0;
+}
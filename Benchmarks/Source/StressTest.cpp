@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    StressTest.cpp
+    Created: 19 Oct 2026 11:07:20pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "StressTest.h"
+
+StressTest::StressTest (int fs, const File& outputFolderToSet) : fs (fs), outputFolder (outputFolderToSet)
+{
+    outputFolder.createDirectory();
+}
+
+void StressTest::run()
+{
+    String report = "Stress test at " + String (fs) + " Hz, block size " + String (Global::stressTestBlockSize)
+                    + ", maximum load " + String (Global::stressTestMaxLoad) + " (99th percentile), " + String (SystemStats::getNumCpus()) + " CPUs\n";
+    
+    for (int t = 0; t < Global::numStressTestThreadCounts; ++t)
+    {
+        int numThreads = Global::stressTestThreadCounts[t];
+        if (numThreads > SystemStats::getNumCpus())
+            break;
+        
+        ThreadPool pool (numThreads);
+        int capacity = 0;
+        for (int g = 0; g < Global::numStressTestGridPoints; ++g)
+        {
+            int targetGridPoints = Global::stressTestGridPoints[g];
+            
+            // the instruments are generated on this thread (they are components), only the rendering happens in parallel
+            std::vector<std::shared_ptr<Instrument>> instruments;
+            for (int i = 0; i < numThreads; ++i)
+            {
+                Random random (Global::stressTestSeed + targetGridPoints * 64 + i);
+                std::shared_ptr<Instrument> instrument = generateInstrument (targetGridPoints, random);
+                if (instrument == nullptr)
+                    break;
+                instruments.push_back (instrument);
+            }
+            if (static_cast<int> (instruments.size()) < numThreads)
+            {
+                report << String (numThreads) << " thread(s), " << String (targetGridPoints) << " grid points: no valid instrument after " << String (Global::stressTestMaxGenerateAttempts) << " attempts\n";
+                break;
+            }
+            
+            std::vector<Result> results (numThreads);
+            for (int i = 0; i < numThreads; ++i)
+                pool.addJob ([this, &instruments, &results, i] () { results[i] = render (instruments[i]); return ThreadPoolJob::jobHasFinished; });
+            while (pool.getNumJobs() > 0)
+                Thread::sleep (10);
+            
+            bool passed = true;
+            for (int i = 0; i < numThreads; ++i)
+            {
+                Result& result = results[i];
+                bool instrumentPassed = result.stable && result.p99Load <= Global::stressTestMaxLoad;
+                report << String (numThreads) << " thread(s), " << String (instruments[i]->getTotalGridPoints()) << " grid points (" << String (instruments[i]->getNumResonatorModules()) << " modules), thread " << String (i) << ": "
+                       << (instrumentPassed ? "passed" : (result.stable ? "FAILED (load)" : "FAILED (unstable)"))
+                       << ", load mean " << String (result.meanLoad, 3) << ", p99 " << String (result.p99Load, 3) << ", max " << String (result.maxLoad, 3) << "\n";
+                
+                if (!instrumentPassed)
+                    savePreset (instruments[i], outputFolder.getChildFile ("Failed_" + String (numThreads) + "threads_" + String (targetGridPoints) + "points_" + String (i) + ".xml"));
+                passed = passed && instrumentPassed;
+            }
+            if (!passed)
+                break;
+            capacity = targetGridPoints;
+        }
+        report << "Capacity with " << String (numThreads) << " thread(s): " << String (capacity) << " grid points per thread, " << String (capacity * numThreads) << " in total\n\n";
+    }
+    
+    std::cout << report << std::endl;
+    outputFolder.getChildFile ("Capacity.txt").replaceWithText (report);
+}
+
+std::shared_ptr<Instrument> StressTest::generateInstrument (int targetGridPoints, Random& random)
+{
+    std::vector<ResonatorModuleType> types {stiffString, bar, membrane, thinPlate, stiffMembrane};
+    std::vector<ConnectionType> connectionTypes {rigid, linearSpring, nonlinearSpring};
+    InOutInfo inOutInfo (false);
+    
+    for (int attempt = 0; attempt < Global::stressTestMaxGenerateAttempts; ++attempt)
+    {
+        std::shared_ptr<Instrument> instrument = std::make_shared<Instrument> (fs);
+        bool valid = true;
+        while (valid && instrument->getTotalGridPoints() < targetGridPoints)
+        {
+            ResonatorModuleType rmt = types[random.nextInt (static_cast<int> (types.size()))];
+            NamedValueSet parameters = Global::getDefaultParametersAdvanced (rmt);
+            Global::randomiseParameters (parameters, random, Global::stressTestMaxParameterFactor);
+            
+            // do not let 2D modules overshoot the target by too much (the remaining budget can be below the minimum)
+            if (parameters.contains ("maxPoints"))
+            {
+                int remainingPoints = jmax (Global::stressTestMinPoints, targetGridPoints - instrument->getTotalGridPoints());
+                parameters.set ("maxPoints", jmin (static_cast<int> (parameters["maxPoints"]), remainingPoints));
+            }
+            
+            if (!instrument->addResonatorModule (rmt, parameters, inOutInfo, true))
+            {
+                // an invalid grid (the parameters are random): start over
+                DBG ("Invalid module generated, regenerating the instrument");
+                valid = false;
+                break;
+            }
+            std::shared_ptr<ResonatorModule> res = instrument->getResonatorPtr (instrument->getNumResonatorModules() - 1);
+            
+            // output taps
+            if (res->isModule1D())
+                res->getInOutInfo()->addOutput (0.1 + 0.8 * random.nextDouble(), random.nextInt (2));
+            else
+                res->getInOutInfo()->addOutput (0.1 + 0.8 * random.nextDouble(), 0.1 + 0.8 * random.nextDouble(), random.nextInt (2));
+            
+            // bows only work on 1D modules
+            if (res->isModule1D() && random.nextDouble() < Global::stressTestBowProbability)
+            {
+                res->setExcitationType (bow);
+                res->setBowParams (Global::stressTestBowVelocity);
+                res->setExcitationActive (true);
+            }
+            
+            // connect every new module to one of the existing ones
+            if (instrument->getNumResonatorModules() > 1)
+            {
+                std::shared_ptr<ResonatorModule> otherRes = instrument->getResonatorPtr (random.nextInt (instrument->getNumResonatorModules() - 1));
+                ConnectionType connectionType = connectionTypes[random.nextInt (static_cast<int> (connectionTypes.size()))];
+                if (otherRes->isModule1D())
+                    instrument->addFirstConnection (otherRes, connectionType, 0.1 + 0.8 * random.nextDouble());
+                else
+                    instrument->addFirstConnection (otherRes, connectionType, 0.1 + 0.8 * random.nextDouble(), 0.1 + 0.8 * random.nextDouble());
+                if (res->isModule1D())
+                    instrument->addSecondConnection (res, 0.1 + 0.8 * random.nextDouble());
+                else
+                    instrument->addSecondConnection (res, 0.1 + 0.8 * random.nextDouble(), 0.1 + 0.8 * random.nextDouble());
+                instrument->setCurrentlyActiveConnection (nullptr);
+                instrument->setAction (noAction);
+            }
+            res->triggerRaisedCos();
+        }
+        if (!valid)
+            continue;
+        
+        instrument->resetOverlappingConnectionVectors();
+        instrument->checkIfShouldExciteRaisedCos();
+        return instrument;
+    }
+    DBG ("Could not generate a valid instrument with " + String (targetGridPoints) + " grid points");
+    return nullptr;
+}
+
+StressTest::Result StressTest::render (std::shared_ptr<Instrument> instrument)
+{
+    juce::ScopedNoDenormals noDenormals;
+    Result result;
+    
+    int numBlocks = static_cast<int> (Global::stressTestLength * fs / Global::stressTestBlockSize);
+    double blockDuration = static_cast<double> (Global::stressTestBlockSize) / fs;
+    std::vector<double> loads (numBlocks, 0.0);
+    
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        int64 startTicks = Time::getHighResolutionTicks();
+        for (int i = 0; i < Global::stressTestBlockSize; ++i)
+        {
+            instrument->calculate();
+            instrument->solveInteractions();
+            instrument->excite();
+            float outputL = instrument->getOutputL();
+            float outputR = instrument->getOutputR();
+            instrument->update();
+            
+            if (!std::isfinite (outputL) || !std::isfinite (outputR) || std::abs (outputL) > Global::stressTestMaxOutput || std::abs (outputR) > Global::stressTestMaxOutput)
+                result.stable = false;
+        }
+        loads[b] = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks) / blockDuration;
+        if (!result.stable)
+            return result;
+    }
+    
+    if (numBlocks == 0)
+        return result;
+    
+    for (auto load : loads)
+        result.meanLoad += load;
+    result.meanLoad /= numBlocks;
+    std::sort (loads.begin(), loads.end());
+    result.p99Load = loads[std::min (numBlocks - 1, static_cast<int> (0.99 * numBlocks))];
+    result.maxLoad = loads[numBlocks - 1];
+    return result;
+}
+
+void StressTest::savePreset (std::shared_ptr<Instrument> instrument, const File& file)
+{
+    std::vector<std::shared_ptr<Instrument>> instruments {instrument};
+    PresetData presetData;
+    presetData.readFromInstruments (instruments, fs);
+    
+    std::ofstream stream (file.getFullPathName().toStdString());
+    presetData.writeToXML (stream);
+}
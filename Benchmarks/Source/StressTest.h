@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    StressTest.h
+    Created: 19 Oct 2026 11:07:20pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/Global.h"
+#include "../../Source/Instrument.h"
+#include "../../Source/PresetData.h"
+
+#include <iostream>
+#include <fstream>
+
+/*  Capacity planning with randomised instruments (part of ModularVSTBenchmarks, run with --stress-test).
+ 
+    Instruments with a random mix of resonator modules with randomised parameters, random connections, output taps and active bows are generated up to a target number of grid points. For every thread count in Global::stressTestThreadCounts, the target is increased (Global::stressTestGridPoints) with one instrument per thread rendering in parallel until one of them exceeds Global::stressTestMaxLoad for the 99th percentile of its blocks or becomes unstable.
+    Random parameters can give a grid that does not satisfy the stability condition; such an instrument is regenerated (at most Global::stressTestMaxGenerateAttempts times). A valid grid does not make the instrument stable: nonlinear connections and bows can still make it blow up, which is reported as a failure.
+ 
+    The capacity report and the preset XML of every failing instrument are written to outputFolder.
+ */
+class StressTest
+{
+public:
+    StressTest (int fs, const File& outputFolderToSet);
+    ~StressTest() {};
+    
+    void run();
+    
+private:
+    struct Result
+    {
+        double meanLoad = 0.0; // block processing time relative to the block duration
+        double p99Load = 0.0;
+        double maxLoad = 0.0;
+        bool stable = true;
+    };
+    
+    std::shared_ptr<Instrument> generateInstrument (int targetGridPoints, Random& random);
+    Result render (std::shared_ptr<Instrument> instrument);
+    void savePreset (std::shared_ptr<Instrument> instrument, const File& file);
+    
+    int fs;
+    File outputFolder;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StressTest)
+};
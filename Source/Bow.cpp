@@ -20,8 +20,6 @@ Bow::Bow (int ID, bool isModule1D) : ExciterModule (ID, isModule1D, bow)
     vB = 0;
     q = 0;
     qPrev = 0;
-    
-    prevVb = 0;
 }
 
 Bow::~Bow()
@@ -56,6 +54,13 @@ void Bow::drawExciter (Graphics& g)
 }
 
 void Bow::initialise (NamedValueSet& parametersFromResonator)
+{
+    refreshParameters (parametersFromResonator);
+    
+    controlParameter = 0.2;
+}
+
+void Bow::refreshParameters (NamedValueSet& parametersFromResonator)
 {
     double cSq = *parametersFromResonator.getVarPointer("cSq");
     double kappaSq = *parametersFromResonator.getVarPointer("kappaSq");
@@ -73,14 +78,9 @@ void Bow::initialise (NamedValueSet& parametersFromResonator)
 
     b1 = 2.0 / (k * k);
     b2 = (2.0 * sig1) / (k * h * h);
-    prevVb = 0;
-    
-    controlParameter = 0.2;
-
-
 }
 
-void Bow::calculate (std::vector<double*>& u)
+void Bow::calculate (double** u)
 {
 //    if (isModule1D)
 //    {
@@ -114,15 +114,18 @@ void Bow::calculate (std::vector<double*>& u)
     // error term
     double eps = 1;
     int NRiterator = 0;
+    
+    // the velocity is smoothed per block in the audio callback (see ModularVSTAudioProcessor::stepControlSmoothers), so it can be used directly
     vB = getControlParameter();
+    const double force = f.load (std::memory_order_relaxed); // the same force for the whole sample
     
     b = 2.0 / k * vB + 2.0 * sig0 * vB - b1 * (uI - uIPrev) - cOhSq * (uI1 - 2.0 * uI + uIM1) + kOhhSq * (uI2 - 4.0 * uI1 + 6.0 * uI - 4.0 * uIM1 + uIM2) - b2 * ((uI1 - 2 * uI + uIM1) - (uIPrev1 - 2.0 * uIPrev + uIPrevM1));
 
-    Fb = f / (rho * AorH * h);
+    Fb = force / (rho * AorH * h);
 
     qPrev = 0;
     // NR loop
-    if (f != 0)
+    if (force != 0)
     {
         while (eps > tol && NRiterator < 100)
         {
@@ -133,7 +136,7 @@ void Bow::calculate (std::vector<double*>& u)
             ++NRiterator;
             if (NRiterator > 98)
             {
-                std::cout << "Nope" << std::endl;
+                RTLog::post (RTLogMessage::bowNotConverged, getID(), NRiterator);
             }
         }
 //        std::cout << q << " after " << NRiterator << " iterations." << std::endl;
@@ -143,17 +146,8 @@ void Bow::calculate (std::vector<double*>& u)
     }
     
     // apply to u
-    double excitation = connectionDivisionTerm * BM * f * q * exp (-a * q * q);
+    double excitation = connectionDivisionTerm * BM * force * q * exp (-a * q * q);
     Global::extrapolation (u[0], bp, alpha, -excitation);
     ++calcCounter;
 }
 
-void Bow::hiResTimerCallback()
-{
-    double lpCoeff = 0.99;
-//    vB = 0.2;
-//    f = (1.0 - lpCoeff) * getControlParameter() + lpCoeff * prevVb;
-    vB = (1.0 - lpCoeff) * getControlParameter() + lpCoeff * prevVb;
-    prevVb = vB;
-
-}
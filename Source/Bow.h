@@ -25,11 +25,11 @@ public:
     void drawExciter (Graphics& g) override;
     
     void initialise (NamedValueSet& parameters) override;
-    void calculate (std::vector<double*>& u) override;
+    void refreshParameters (NamedValueSet& parameters) override;
+    void calculate (double** u) override;
     
 //    double getEnergy() override { return 0; };
     
-    void hiResTimerCallback() override;
 private:
     // string variables still needed in the NR solve
     double rho, AorH, sig0, k, h;
@@ -39,7 +39,7 @@ private:
     double a, cOhSq, kOhhSq, tol, BM, q, qPrev, b, b1, b2;
     double uI, uIPrev, uI1, uI2, uIM1, uIM2, uIPrev1, uIPrevM1; // NR states
     
-    double Fb, vB, prevVb;
+    double Fb, vB;
     
     double prop = 0;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Bow)
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    ControlSmoother.h
+    Created: 19 Oct 2026 11:58:12am
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+// One-pole smoother that is advanced at control rate (every Global::controlRateInterval samples) and linearly interpolated in between.
+class ControlSmoother
+{
+public:
+    ControlSmoother (double initValue = 0.0) : prevValue (initValue), nextValue (initValue) {};
+    ~ControlSmoother() {};
+
+    // Set the coefficient for a full control-rate step. Only needs to be called once per block.
+    void setCoefficient (double c) { coeff = c; };
+
+    // Jump to a value without smoothing
+    void setValue (double val) { prevValue = val; nextValue = val; };
+
+    // Advance the filter by one control-rate step towards the target
+    void step (double target)
+    {
+        prevValue = nextValue;
+        nextValue = coeff * nextValue + (1.0 - coeff) * target;
+    };
+
+    // alpha is the position (0-1) within the current control-rate interval
+    double getValue (double alpha) { return prevValue + alpha * (nextValue - prevValue); };
+    double getNextValue() { return nextValue; };
+
+    // Check whether the value has moved far enough from the value that was last pushed to the instrument
+    bool shouldPush (double val) { return std::abs (val - lastPushedValue) > Global::controlChangeThreshold; };
+    void setPushed (double val) { lastPushedValue = val; };
+
+    // Make sure that the next value gets pushed regardless of the threshold
+    void resetPushed() { lastPushedValue = std::numeric_limits<double>::max(); };
+
+private:
+    double coeff = 0.0;
+    double prevValue;
+    double nextValue;
+    double lastPushedValue = std::numeric_limits<double>::max();
+
+    JUCE_LEAK_DETECTOR (ControlSmoother)
+};
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    DSPLoadMeter.cpp
+    Created: 19 Oct 2026 7:15:21pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "DSPLoadMeter.h"
+
+DSPLoadMeter::DSPLoadMeter()
+{
+    secondsPerTick = 1.0 / static_cast<double> (Time::getHighResolutionTicksPerSecond());
+    std::fill (stageTicks, stageTicks + numStages, 0);
+    std::fill (moduleTicks, moduleTicks + numModuleTypes, 0);
+}
+
+void DSPLoadMeter::beginBlock (int numSamples, double fs)
+{
+    std::fill (stageTicks, stageTicks + numStages, 0);
+    std::fill (moduleTicks, moduleTicks + numModuleTypes, 0);
+    blockDeadline = numSamples / fs;
+    int numTimedSamples = (numSamples + Global::loadMeterSampleInterval - 1) / Global::loadMeterSampleInterval;
+    sampleScale = numTimedSamples > 0 ? static_cast<double> (numSamples) / numTimedSamples : 1.0;
+    blockStartTicks = getTicks();
+}
+
+int64 DSPLoadMeter::addStageTime (Stage stage, int64 startTicks)
+{
+    int64 now = getTicks();
+    stageTicks[stage] += now - startTicks;
+    return now;
+}
+
+void DSPLoadMeter::addModuleTime (ResonatorModuleType rmt, int64 startTicks)
+{
+    moduleTicks[rmt] += getTicks() - startTicks;
+}
+
+void DSPLoadMeter::endBlock (int instrumentIdx)
+{
+    const double microsecondsPerTick = 1e6 * secondsPerTick;
+    if (instrumentIdx >= 0 && instrumentIdx < Global::maxMeteredInstruments)
+        for (int s = 0; s < numStages; ++s)
+            stageHistories[instrumentIdx][s].push (static_cast<float> (stageTicks[s] * getStageScale (static_cast<Stage> (s)) * microsecondsPerTick));
+    
+    for (int m = 1; m < numModuleTypes; ++m)
+        if (moduleTicks[m] != 0)
+            moduleHistories[m].push (static_cast<float> (moduleTicks[m] * sampleScale * microsecondsPerTick));
+    
+    if (blockDeadline > 0)
+    {
+        float load = static_cast<float> ((getTicks() - blockStartTicks) * secondsPerTick / blockDeadline);
+        loadHistory.push (load);
+        smoothedLoad.store (smoothedLoad.load() + Global::governorLoadSmoothing * (load - smoothedLoad.load()));
+    }
+}
+
+DSPLoadMeter::Statistics DSPLoadMeter::getStageStatistics (int instrumentIdx, Stage stage)
+{
+    if (instrumentIdx < 0 || instrumentIdx >= Global::maxMeteredInstruments)
+        return {};
+    return stageHistories[instrumentIdx][stage].getStatistics();
+}
+
+DSPLoadMeter::Statistics DSPLoadMeter::getModuleTypeStatistics (ResonatorModuleType rmt)
+{
+    return moduleHistories[rmt].getStatistics();
+}
+
+const char* DSPLoadMeter::getStageName (Stage stage)
+{
+    switch (stage)
+    {
+        case calculateStage:
+            return "calculate";
+        case interactionStage:
+            return "interactions";
+        case exciteStage:
+            return "excite";
+        case outputStage:
+            return "output";
+        case updateStage:
+            return "update";
+        case smoothingStage:
+            return "smoothing";
+        case parallelStage:
+            return "parallel";
+        default:
+            return "";
+    }
+}
+
+//==============================================================================
+void DSPLoadMeter::History::push (float value)
+{
+    values[writeIdx].store (value, std::memory_order_relaxed);
+    writeIdx = (writeIdx + 1) % Global::loadMeterHistorySize;
+    if (numValues.load (std::memory_order_relaxed) < Global::loadMeterHistorySize)
+        numValues.fetch_add (1, std::memory_order_release);
+}
+
+DSPLoadMeter::Statistics DSPLoadMeter::History::getStatistics()
+{
+    Statistics statistics;
+    int n = numValues.load (std::memory_order_acquire);
+    if (n == 0)
+        return statistics;
+    
+    std::vector<float> sorted (n);
+    for (int i = 0; i < n; ++i)
+        sorted[i] = values[i].load (std::memory_order_relaxed);
+    std::sort (sorted.begin(), sorted.end());
+    
+    double sum = 0.0;
+    for (auto value : sorted)
+        sum += value;
+    
+    statistics.mean = sum / n;
+    statistics.p99 = sorted[jmin (n - 1, static_cast<int> (0.99 * n))];
+    statistics.max = sorted[n - 1];
+    return statistics;
+}
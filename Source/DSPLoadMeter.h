@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    DSPLoadMeter.h
+    Created: 19 Oct 2026 7:15:21pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+/*  Timing of the stages of processBlock (per instrument), of the calculate function of every resonator module type and of the total callback against the block deadline.
+ 
+    The audio thread adds timings using the high resolution tick counter and pushes the totals of every block into rolling histories (Global::loadMeterHistorySize blocks) without locking or allocating. The statistics (mean, p99 and max) are calculated on request on the message thread.
+ 
+    Reading the clock costs about as much as a small module, so the per-sample stages and the modules are only timed once every Global::loadMeterSampleInterval samples and scaled up to the block. The parallel stage and the total load are timed over the whole block.
+ */
+class DSPLoadMeter
+{
+public:
+    enum Stage
+    {
+        calculateStage = 0,
+        interactionStage,
+        exciteStage,
+        outputStage,
+        updateStage,
+        smoothingStage,
+        parallelStage, // all stages of the independent parts of an instrument together
+        numStages
+    };
+    
+    struct Statistics
+    {
+        double mean = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    DSPLoadMeter();
+    ~DSPLoadMeter() {};
+    
+    void setEnabled (bool e) { enabled = e; };
+    bool isEnabled() { return enabled.load(); };
+    
+    static int64 getTicks() { return Time::getHighResolutionTicks(); };
+    
+    // Audio thread
+    void beginBlock (int numSamples, double fs);
+    static bool shouldTimeSample (int sampleIdx) { return sampleIdx % Global::loadMeterSampleInterval == 0; };
+    int64 addStageTime (Stage stage, int64 startTicks);                 // returns the current ticks to chain stages
+    void addModuleTime (ResonatorModuleType rmt, int64 startTicks);
+    void endBlock (int instrumentIdx);                                  // -1 if no instrument was processed
+    
+    // Message thread. Stage and module timings are in microseconds per block, the load is the fraction of the block deadline.
+    Statistics getStageStatistics (int instrumentIdx, Stage stage);
+    Statistics getModuleTypeStatistics (ResonatorModuleType rmt);
+    Statistics getLoadStatistics() { return loadHistory.getStatistics(); };
+    float getSmoothedLoad() { return smoothedLoad.load(); }; // reacts faster than the statistics (used by the LoadGovernor)
+    
+    static const char* getStageName (Stage stage);
+    
+    // Audio thread. Time spent in a stage during the current block (in microseconds)
+    double getBlockStageTime (Stage stage) { return stageTicks[stage] * getStageScale (stage) * 1e6 * secondsPerTick; };
+    
+private:
+    // Ring buffer of values. Written by the audio thread, read by the message thread.
+    class History
+    {
+    public:
+        History() : values (new std::atomic<float>[Global::loadMeterHistorySize]) {};
+        void push (float value);
+        Statistics getStatistics();
+        
+    private:
+        std::unique_ptr<std::atomic<float>[]> values;
+        std::atomic<int> numValues { 0 };
+        int writeIdx = 0;
+    };
+    
+    static const int numModuleTypes = stiffMembrane + 1;
+    
+    // the timed samples are scaled to the whole block (the parallel stage is always timed over the whole block)
+    double getStageScale (Stage stage) { return stage == parallelStage ? 1.0 : sampleScale; };
+    
+    std::atomic<bool> enabled { Global::enableLoadMeter };
+    
+    int64 blockStartTicks = 0;
+    double blockDeadline = 0.0; // in seconds
+    double secondsPerTick;
+    double sampleScale = 1.0; // number of samples in the block / number of timed samples
+    
+    // Totals of the current block (in ticks)
+    int64 stageTicks[numStages];
+    int64 moduleTicks[numModuleTypes];
+    
+    History stageHistories[Global::maxMeteredInstruments][numStages];
+    History moduleHistories[numModuleTypes];
+    History loadHistory;
+    std::atomic<float> smoothedLoad { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DSPLoadMeter)
+};
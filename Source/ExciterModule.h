@@ -12,10 +12,11 @@
 
 #include <JuceHeader.h>
 #include "Global.h"
+#include "RTLog.h"
 //==============================================================================
 /*
 */
-class ExciterModule : public HighResolutionTimer, public ChangeBroadcaster
+class ExciterModule
 {
 public:
     ExciterModule (int ID, bool isModule1D, ExcitationType excitationType = noExcitation);
@@ -29,8 +30,9 @@ public:
     virtual void setNxNy (int NxToSet, int NyToSet) { Nx = NxToSet; Ny = NyToSet; };
     
     virtual void initialise (NamedValueSet& parametersFromResonator) {};
+    virtual void refreshParameters (NamedValueSet& parametersFromResonator) {}; // only refresh what depends on the resonator (does not reset the exciter)
     
-    virtual void calculate (std::vector<double*>& u) {};
+    virtual void calculate (double** u) {};
     virtual void updateStates() {};
     virtual double getEnergy() { return 0; };
 
@@ -51,8 +53,6 @@ public:
 
     void updateSmoothExcitation();
     
-    void hiResTimerCallback() override {};
-    
     long getCalcCounter() { return calcCounter; };
     
     virtual void mouseEntered (const double x, const double y, int height) {};
@@ -61,9 +61,9 @@ public:
 
     bool isModuleReady() { return moduleIsReady; };
     
-    void setStatesToZero() { action = setStatesToZeroAction; sendChangeMessage(); };
-    Action getAction() { return action; };
-    void setAction (Action a) { action = a; };
+    // Called from calculate when the exciter blows up. The instrument picks the request up at the start of the next block (see ModularVSTAudioProcessor::processBlock)
+    void setStatesToZero() { statesToZeroRequested = true; };
+    bool takeStatesToZeroRequest() { return statesToZeroRequested.exchange (false); };
     
     virtual void saveOutput() {};
     
@@ -81,8 +81,10 @@ protected:
     double controlLoc = 0;
 
     int N, Nx, Ny;
-    double f = 1;
-    double controlParameter = 6; // parameter to be controlled by the application. Could be bow velocity fx.
+    
+    // Set from the message thread (mouse) and the audio thread (smoothed parameters, see ModularVSTAudioProcessor::stepControlSmoothers) and read in calculate
+    std::atomic<double> f { 1 };
+    std::atomic<double> controlParameter { 6 }; // parameter to be controlled by the application. Could be bow velocity fx.
     bool trigger = false;
     
     long calcCounter = 0;
@@ -93,6 +95,6 @@ protected:
     
 private:
     int ID = -1;
-    Action action = noAction;
+    std::atomic<bool> statesToZeroRequested { false }; // exciters can be calculated on the worker threads
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExciterModule)
 };
@@ -13,6 +13,7 @@
 //#define USE_EIGEN     // use overlapping connections (and therefore the eigen library) or not
 //#define CALC_ENERGY // calculate (and print) energy or not
 //#define SAVE_OUTPUT
+//#define KERNEL_EQUIVALENCE_CHECK // adds the scalar reference calculate functions of the resonator modules. Defined by the test project (see Tests/Source/KernelEquivalenceCheck)
 
 #if (BUILD_CONFIG == 1) // Testing for Unity
     #define EDITOR_AND_SLIDERS
@@ -82,7 +83,7 @@ enum Action
     graphicsToggleAction,
     
     refreshEditorAction,
-    setStatesToZeroAction
+    regridAction
     
 };
 
@@ -140,6 +141,19 @@ enum PresetResult
     presetNotLoaded
 };
 
+enum ProcessingMode
+{
+    realTimeMode = 0,
+    offlineMode, // e.g., when the host is bouncing. Allows much larger grids
+    numProcessingModes
+};
+
+enum LoadSheddingAction
+{
+    sleepQuietModuleAction,
+    reduce2DResolutionAction
+};
+
 namespace Global
 {
     static const bool showGraphicsToggle = true;
@@ -167,6 +181,109 @@ namespace Global
     static const double stringVisualScaling = 200.0;
 
     static const double excitationVisualWidth = 6;
+    static const double visualSnapshotRate = 60.0; // in Hz. Rate at which the audio thread publishes the states for the editor
+    static const int maxIntervals1D[numProcessingModes] = {1000, 20000}; // limits on the grid sizes per processing mode
+    static const int maxPoints2D[numProcessingModes] = {10000, 250000};
+    static const int kernelBlockColumns = 256; // width of the column strips of the blocked 2D kernels (the rows of the stencil in a strip stay in L1)
+    static const double visualChangeThreshold = 0.5; // in pixels (1D) or grey levels (2D). Smaller changes of the state are not repainted
+    static const float minGridLineSpacing = 6.0f; // in pixels. Grid lines of 2D modules are only drawn when the grid points are at least this large
+
+    // control-rate parameter smoothing
+    static const int controlRateInterval = 32; // in samples
+    static const double controlChangeThreshold = 1e-5; // minimum change before exciter positions and bow parameters are updated
+    static const int audioRequestPollInterval = 20; // in ms. Interval at which the message thread handles the requests that the audio thread signals through flags (e.g. regrids needed by the modulation)
+    
+    static const String binaryPresetExtension = ".mvsp"; // presets with this extension are saved and loaded in the binary format (see PresetData)
+    static const int presetCacheSize = 4; // number of parsed embedded presets kept in memory (see PresetIndex)
+    static const bool saveStatesInSession = true; // include the states of the resonator modules in the host session
+    static const int stateSnapshotTimeout = 100; // in ms. Maximum time to wait for the audio thread to copy the states
+    static const int rtLogSize = 256; // number of records the real-time log can hold before they are dropped
+    static const int rtLogDrainInterval = 50; // in ms
+    static const bool enableLoadMeter = false; // time the stages of processBlock (see DSPLoadMeter). Can be changed at runtime
+    static const int loadMeterSampleInterval = 32; // the stages and modules are timed once every this many samples (and scaled to the block)
+    static const bool showLoadMeter = false; // show the load meter overlay in the editor
+    static const int loadMeterHistorySize = 512; // in blocks
+    static const int maxMeteredInstruments = 8;
+    static const int traceCaptureSize = 1 << 18; // maximum number of events in a trace capture
+
+    // load governor (sheds load when the callback gets close to its deadline, see LoadGovernor). Only active when the load meter is enabled.
+    static const bool enableLoadGovernor = false;
+    static const int governorInterval = 50; // in ms
+    static const float governorLoadSmoothing = 0.1f; // one-pole coefficient per block
+    static const float governorHighLoad = 0.85f; // smoothed load above which load is shed
+    static const float governorLowLoad = 0.5f; // smoothed load below which load is restored
+    static const double governorHoldTime = 250.0; // in ms. The load has to stay above governorHighLoad this long before every step
+    static const double governorRecoverTime = 2000.0; // in ms. The load has to stay below governorLowLoad this long before the last step is undone
+    static const double governorRestoreProbation = 1000.0; // in ms. Load shed this soon after a restore means that the restore overloaded the callback
+    static const double governorMaxRecoverTime = 64000.0; // in ms. The recover time doubles after every restore that overloaded, up to this
+    static const double governorSleepLevel = 0.01; // modules quieter than this (relative to the loudest module of the instrument) may be put to sleep
+    static const double governorMaxPointsFactor = 0.7; // per step
+    static const int governorMinPoints2D = 400;
+    static const int governorReportSize = 32; // number of steps that are remembered for the report
+    static const LoadSheddingAction governorPolicy[] = {sleepQuietModuleAction, reduce2DResolutionAction}; // in order of priority
+    static const int numGovernorPolicyActions = 2;
+
+    // parallel processing of the independent parts of an instrument (see Instrument::processPartitions)
+    static const bool enableParallelPartitions = true;
+    static const int maxWorkerThreads = 3; // in addition to the audio thread
+    static const double workerSpinTime = 0.0002; // in seconds. How long a worker keeps looking for new tasks before it blocks
+    static const int partitionChunkSize = 256; // in samples. The outputs of the partitions are joined after every chunk
+
+    // row-band decomposition of the calculate() of large 2D modules (see Instrument::calculateResonator)
+    static const bool enableBandDecomposition = true;
+    static const int minPointsForBands = 2500; // smaller modules are not worth the synchronisation
+    static const int minRowsPerBand = 8;
+    static const int bandHaloRows = 2; // rows on either side of a band that its stencil reads (13-point stencil of the stiff membrane)
+    static const int l2CacheBytes = 256 * 1024; // conservative per-core L2 size that the bands are sized for
+    static const double presetCrossfadeTime = 0.02; // in seconds. Set to 0 to switch to a preset loaded in the background without crossfading
+
+    // preset render check (Tests/Source/PresetRenderCheck)
+    static const String renderCheckFolder = "Tests/References"; // relative to the root of the repository
+    static const int renderCheckSampleRate = 44100;
+    static const double renderCheckLength = 1.0; // in seconds
+    static const int renderCheckBlockSizes[] = {32, 64, 512}; // the largest block size should be last
+    static const int numRenderCheckBlockSizes = 3;
+    static const int renderCheckFrameSize = 2048; // power of two
+    static const float renderCheckSpectrumFloor = -120.0f; // in dB
+    static const float renderCheckMaxAbsError = 1e-6f;
+    static const float renderCheckMaxSpectralDistance = 0.1f; // in dB
+
+    // kernel equivalence check (Tests/Source/KernelEquivalenceCheck)
+    static const int kernelCheckSampleRate = 44100;
+    static const int kernelCheckNumCases = 8; // randomised parameter sets per module type and boundary condition
+    static const int kernelCheckNumSingleSteps = 100; // steps that are compared to the step reference
+    static const int kernelCheckNumSteps = 44100; // length of the long run (divergence)
+    static const double kernelCheckInitAmplitude = 1e-4;
+    static const int kernelCheckSeed = 1234;
+    static const int64 kernelCheckMaxUlps = 4; // per step. Allows for a different order of additions (SIMD)
+    static const double kernelCheckMaxDivergence = 1e-9; // relative, after kernelCheckNumSteps
+    static const int connectionCheckNumSteps = 4410;
+    static const double connectionCheckMaxError = 1e-9; // relative
+
+    // connection solver benchmark (Benchmarks/Source/ConnectionSolverBenchmark)
+    static const int connectionBenchmarkSampleRate = 44100;
+    static const int connectionBenchmarkNumModules = 16; // minimum, more are added if the connections need more points
+    static const int connectionBenchmarkNumConnections[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000};
+    static const int numConnectionBenchmarkSizes = 10;
+    static const double connectionBenchmarkLength = 0.5; // in seconds (per configuration)
+    static const int connectionBenchmarkNumResets = 10;
+
+    // stress test (Benchmarks/Source/StressTest)
+    static const int stressTestSampleRate = 44100;
+    static const int stressTestGridPoints[] = {250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000}; // target per thread
+    static const int numStressTestGridPoints = 9;
+    static const int stressTestThreadCounts[] = {1, 2, 4, 8, 16};
+    static const int numStressTestThreadCounts = 5;
+    static const int stressTestBlockSize = 512;
+    static const double stressTestLength = 2.0; // in seconds (per instrument)
+    static const double stressTestMaxLoad = 0.7; // relative to the block duration
+    static const float stressTestMaxOutput = 100.0f; // above this an instrument is considered unstable
+    static const double stressTestMaxParameterFactor = 2.0;
+    static const int stressTestMinPoints = 100; // for 2D modules
+    static const int stressTestMaxGenerateAttempts = 20; // per instrument, after which the target is reported as not generated
+    static const double stressTestBowProbability = 0.3;
+    static const double stressTestBowVelocity = 0.2;
+    static const int stressTestSeed = 4321;
 
     // default parameters
     static const double defaultLinSpringCoeff = 1e8;
@@ -363,4 +480,34 @@ namespace Global
 
     }
 
+    static NamedValueSet getDefaultParametersAdvanced (ResonatorModuleType rmt)
+    {
+        switch (rmt)
+        {
+            case stiffString:
+                return defaultStringParametersAdvanced;
+            case bar:
+                return defaultBarParametersAdvanced;
+            case membrane:
+                return defaultMembraneParametersAdvanced;
+            case thinPlate:
+                return defaultThinPlateParametersAdvanced;
+            case stiffMembrane:
+            default:
+                return defaultStiffMembraneParametersAdvanced;
+        }
+    }
+
+    // Scales every physical parameter by a random factor between 1 / maxFactor and maxFactor (used by the diagnostics)
+    static void randomiseParameters (NamedValueSet& parameters, Random& random, double maxFactor)
+    {
+        for (int i = 0; i < parameters.size(); ++i)
+        {
+            Identifier name = parameters.getName (i);
+            if (name == Identifier ("maxPoints") || name == Identifier ("nu"))
+                continue;
+            parameters.set (name, static_cast<double> (*parameters.getVarPointerAt (i)) * pow (maxFactor, 2.0 * random.nextDouble() - 1.0));
+        }
+    }
+
 };
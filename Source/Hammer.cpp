@@ -100,6 +100,15 @@ void Hammer::drawExciter (Graphics& g)
 }
 
 void Hammer::initialise (NamedValueSet& parametersFromResonator)
+{
+    refreshParameters (parametersFromResonator);
+    
+    controlParameter = isModule1D ? 6 : 1;
+    
+    moduleIsReady = true;
+}
+
+void Hammer::refreshParameters (NamedValueSet& parametersFromResonator)
 {
     h = *parametersFromResonator.getVarPointer ("h");
     rho = *parametersFromResonator.getVarPointer ("rho");
@@ -120,13 +129,9 @@ void Hammer::initialise (NamedValueSet& parametersFromResonator)
     C1 *= Adiv;
     
     Jterm = k * k / (rho * AorH * (1.0 + sig0 * k)); // connection division term without division by h
-    
-    controlParameter = isModule1D ? 6 : 1;
-    
-    moduleIsReady = true;
 }
 
-void Hammer::calculate (std::vector<double*>& u)
+void Hammer::calculate (double** u)
 {
     // "trigger ? 0 : 1" in the paper :O
     force = (forceIsZero ? 0 : 1) * (trigger ? -1 : 1) * K * (-controlLoc + 0.5) / (Global::stringVisualScaling);
@@ -170,7 +175,7 @@ void Hammer::calculate (std::vector<double*>& u)
         }
     } else {
         if (!isModule1D)
-            DBG("Not made for 2D yet!!");
+            RTLog::post (RTLogMessage::exciterNotMadeFor2D, getID());
         if (width > N-1)
             width = 2;
         cLoc = Global::limit (floor (excitationLoc * N), ceil(ceil(width)*0.5) + 1, N-ceil(ceil(width)*0.5) - 1);
@@ -204,7 +209,7 @@ void Hammer::calculate (std::vector<double*>& u)
         }
     }
     if (std::isnan(IJ))
-        DBG("wait what?");
+        RTLog::post (RTLogMessage::exciterInterpolationIsNan, getID());
     eta = w - uI;
     etaPrev = wPrev - uIPrev;
 
@@ -290,19 +295,19 @@ void Hammer::calculate (std::vector<double*>& u)
     
     if (force > 200)
     {
-        std::cout << "Details: " << "etaStar - etaPrev: " << etaStar - etaPrev << " g: " << g << std::endl;
+        RTLog::post (RTLogMessage::exciterForceTooLarge, getID(), etaStar - etaPrev, g);
         wNext = 0;
         w = 0;
         wPrev = 0;
         psi = 0;
         psiPrev = 0;
-        std::cout << "States are set to zero" << std::endl;
+        RTLog::post (RTLogMessage::exciterStatesReset, getID());
         setStatesToZero();
     }
     
 
     if (std::isnan(wNext))
-        DBG("wait");
+        RTLog::post (RTLogMessage::exciterStateIsNan, getID());
     ++calcCounter;
     
 
@@ -345,11 +350,6 @@ double Hammer::getEnergy()
     return kinEnergy + potEnergy + totDampEnergy + collEnergy - totPowEnergy; // NOTE THE MINUS-SIGN FOR THE POWER
 }
 
-void Hammer::hiResTimerCallback()
-{
-    double lpCoeff = 0.99;
-}
-
 void Hammer::mouseEntered (const double x, const double y, int height)
 {
     if (isModule1D)
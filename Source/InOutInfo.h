@@ -32,10 +32,12 @@ public:
     int getInChannelAt (int idx) { return inChannels[idx]; };
 
     int getOutLocAt (int idx) { return outLocs[idx]; };
+    void setOutLocAt (int idx, int loc) { outLocs[idx] = loc; }; // used when regridding
     int getOutChannelAt (int idx) { return outChannels[idx]; };
 
     bool isDefaultInit() { return defaultInit; };
     void setN (std::vector<int> NtoSet) { N = NtoSet; };
+    void setNAt (int idx, int NtoSet) { N[idx] = NtoSet; }; // doesn't allocate
     
 private:
     
@@ -12,7 +12,7 @@
 #include "Instrument.h"
 
 //==============================================================================
-Instrument::Instrument (int fs) : fs (fs)
+Instrument::Instrument (int fs, ProcessingMode processingMode) : fs (fs), processingMode (processingMode)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -29,6 +29,7 @@ Instrument::~Instrument()
 
 void Instrument::paint (juce::Graphics& g)
 {
+    TraceCapture::Scope traceScope ("paintInstrument");
     /* This demo code just fills the component's background and
        draws some placeholder text to get you started.
 
@@ -73,7 +74,7 @@ void Instrument::paint (juce::Graphics& g)
         {
             xLoc1 = getWidth() * static_cast<float>(CI[i].loc1) / CI[i].res1->getNumIntervals();
             yLoc1 = (0.5 + CI[i].res1->getID()) * moduleHeight
-                - CI[i].res1->getStateAt (CI[i].loc1, 1) * CI[i].res1->getVisualScaling() * moduleHeight;
+                - CI[i].res1->getVisualStateAt (CI[i].loc1) * CI[i].res1->getVisualScaling() * moduleHeight;
             g.drawEllipse (xLoc1 - Global::connRadius, yLoc1 - Global::connRadius,
                2.0 * Global::connRadius, 2.0 * Global::connRadius, 2.0);
             if (&CI[i] == currentlyActiveConnection  && applicationState != normalState)
@@ -124,7 +125,7 @@ void Instrument::paint (juce::Graphics& g)
         {
             xLoc2 = getWidth() * static_cast<float>(CI[i].loc2) / CI[i].res2->getNumIntervals();
             yLoc2 = (0.5 + CI[i].res2->getID()) * moduleHeight
-                - CI[i].res2->getStateAt (CI[i].loc2, 1) * CI[i].res2->getVisualScaling() * moduleHeight;
+                - CI[i].res2->getVisualStateAt (CI[i].loc2) * CI[i].res2->getVisualScaling() * moduleHeight;
             g.drawEllipse (xLoc2 - Global::connRadius, yLoc2 - Global::connRadius,
                2.0 * Global::connRadius, 2.0 * Global::connRadius, 2.0);
             
@@ -219,34 +220,69 @@ void Instrument::resized()
             res->setBounds(totalArea.removeFromTop (resonatorModuleHeight));
 }
 
-void Instrument::addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo& inOutInfo, bool advanced)
+void Instrument::attachView()
+{
+    if (viewAttached)
+        return;
+    
+    // same order as when they would have been added one by one
+    for (auto res : resonators)
+        addAndMakeVisible (res.get(), 0);
+    viewAttached = true;
+}
+
+bool Instrument::takeStatesToZeroRequest()
+{
+    bool requested = false;
+    for (auto res : resonators)
+        if (res->isModuleReady())
+            requested = res->takeStatesToZeroRequest() || requested;
+    return requested;
+}
+
+bool Instrument::addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo& inOutInfo, bool advanced)
 {
     std::shared_ptr<ResonatorModule> newResonatorModule;
     switch (rmt)
     {
         case stiffString:
-            newResonatorModule = std::make_shared<StiffString> (rmt, parameters, advanced, fs, resonators.size(), this, inOutInfo);
+            newResonatorModule = std::make_shared<StiffString> (rmt, parameters, advanced, fs, resonators.size(), this, processingMode, inOutInfo);
             break;
         case bar:
-            newResonatorModule = std::make_shared<Bar> (rmt, parameters, advanced, fs, resonators.size(), this, inOutInfo);
+            newResonatorModule = std::make_shared<Bar> (rmt, parameters, advanced, fs, resonators.size(), this, processingMode, inOutInfo);
             break;
         case membrane:
-            newResonatorModule = std::make_shared<Membrane> (rmt, parameters, advanced, fs, resonators.size(), this, inOutInfo);
+            newResonatorModule = std::make_shared<Membrane> (rmt, parameters, advanced, fs, resonators.size(), this, processingMode, inOutInfo);
             break;
         case thinPlate:
-            newResonatorModule = std::make_shared<ThinPlate> (rmt, parameters, advanced, fs, resonators.size(), this, inOutInfo);
+            newResonatorModule = std::make_shared<ThinPlate> (rmt, parameters, advanced, fs, resonators.size(), this, processingMode, inOutInfo);
             break;
         case stiffMembrane:
-            newResonatorModule = std::make_shared<StiffMembrane> (rmt, parameters, advanced, fs, resonators.size(), this, inOutInfo);
+            newResonatorModule = std::make_shared<StiffMembrane> (rmt, parameters, advanced, fs, resonators.size(), this, processingMode, inOutInfo);
             break;
-
+        default:
+            DBG ("Unknown resonator module type");
+            return false;
+    }
+    
+    if (!newResonatorModule->ableToInitialise())
+    {
+        if (!viewAttached)
+            DBG ("Could not initialise resonator module: " + newResonatorModule->getErrorMsg());
+        else
+            NativeMessageBox::showMessageBoxAsync (AlertWindow::AlertIconType::WarningIcon, newResonatorModule->getErrorMsg(), "Please change your parameters", this, ModalCallbackFunction::create ([&] (int test){ test = 1; }));
+        return false;
     }
 
+    topologyChanged();
     resonators.push_back (newResonatorModule);
-    addAndMakeVisible (resonators[resonators.size()-1].get(), 0);
+    if (viewAttached)
+        addAndMakeVisible (resonators[resonators.size()-1].get(), 0);
     currentlySelectedResonator = newResonatorModule;
     newResonatorModule->setExcitationType (excitationType);
     resetTotalGridPoints();
+    refreshPartitions();
+    return true;
 }
 
 void Instrument::removeResonatorModule()
@@ -274,6 +310,7 @@ void Instrument::removeResonatorModule()
 //        }
 //    }
 //    
+    topologyChanged();
     int i = 0;
     while (i < CI.size())
     {
@@ -292,6 +329,7 @@ void Instrument::removeResonatorModule()
 
     resetResonatorIndices();
     resetTotalGridPoints();
+    refreshPartitions();
 }
 
 void Instrument::removeAllResonators()
@@ -299,11 +337,12 @@ void Instrument::removeAllResonators()
     for (auto res : resonators)
         res->unReadyModule();
     
+    topologyChanged();
     resonators.clear();
 
     currentlySelectedResonator = nullptr;
     resonatorToRemove = nullptr;
-
+    refreshPartitions();
 }
 
 void Instrument::resetResonatorIndices()
@@ -335,15 +374,45 @@ bool Instrument::areModulesReady()
    return true;
 }
 
-void Instrument::calculate()
+void Instrument::calculate (bool timeModules)
 {
+    int numCores = (Global::enableBandDecomposition && workerPool != nullptr) ? workerPool->getNumThreads() + 1 : 1;
+    if (!timeModules || loadMeter == nullptr)
+    {
+        for (auto res : resonators)
+            if (!res->isSleeping())
+                calculateResonator (*res, numCores);
+        return;
+    }
+    
     for (auto res : resonators)
-        res->calculate();
+    {
+        if (res->isSleeping())
+            continue;
+        int64 startTicks = DSPLoadMeter::getTicks();
+        calculateResonator (*res, numCores);
+        loadMeter->addModuleTime (res->getResonatorModuleType(), startTicks);
+    }
+}
+
+void Instrument::calculateResonator (ResonatorModule& res, int numCores)
+{
+    int numBands = numCores > 1 ? res.getNumCalculateBands (numCores) : 1;
+    if (numBands <= 1)
+    {
+        res.calculate();
+        return;
+    }
+    
+    // run() returns once all bands are done, so the connections and exciters that follow always see the complete state. This happens every sample, so the workers spin in between instead of blocking (see WorkerPool)
+    bandJob.res = &res;
+    bandJob.numBands = numBands;
+    workerPool->run (bandJob, numBands);
 }
 
 void Instrument::solveInteractions()
 {
-    if (applicationState != normalState)
+    if (applicationState != normalState && applicationState != editDensityState)
         return;
     
     if (CI.size() == 0)
@@ -353,54 +422,56 @@ void Instrument::solveInteractions()
         solveOverlappingConnections (CIOverlapVector[i]);
 
     // solve the rest of the connections
-    double force = 0;
-    double rPlus;
-    double rMin;
     for (int i = 0; i < CI.size(); ++i)
     {
         jassert (CI[i].connected);
         if (CI[i].connectionGroup != -1)
             continue;
-        
-        K1 = CI[i].K1;
-        K3 = CI[i].K3;
-        R = CI[i].R;
-        
-        CI[i].etaNext = CI[i].res1->getStateAt (CI[i].loc1, 0) - CI[i].res2->getStateAt (CI[i].loc2, 0);
-        CI[i].eta = CI[i].res1->getStateAt (CI[i].loc1, 1) - CI[i].res2->getStateAt (CI[i].loc2, 1);
-        CI[i].etaPrev = CI[i].res1->getStateAt (CI[i].loc1, 2) - CI[i].res2->getStateAt (CI[i].loc2, 2);
-        
-        rPlus = 0.5 * K1 + 0.5 * K3 * CI[i].eta * CI[i].eta + 0.5 * fs * R;
-        rMin = 0.5 * K1 + 0.5 * K3 * CI[i].eta * CI[i].eta - 0.5 * fs * R;
-        
-        switch (CI[i].connType)
-        {
-            case rigid:
-                force = CI[i].etaNext
-                    / (CI[i].res1->getConnectionDivisionTerm() + CI[i].res2->getConnectionDivisionTerm());
-                break;
-            case linearSpring:
-//                force = (CI[i].etaNext + CI[i].etaPrev)
-//                    / (2.0 / K1 + CI[i].res1->getConnectionDivisionTerm()
-//                       + CI[i].res2->getConnectionDivisionTerm());
-                force = (CI[i].etaNext + rMin / rPlus * CI[i].etaPrev)
-                    / (1.0 / rPlus + CI[i].res1->getConnectionDivisionTerm()
-                       + CI[i].res2->getConnectionDivisionTerm());
-                break;
-            case nonlinearSpring:
-                force = (CI[i].etaNext + rMin / rPlus * CI[i].etaPrev)
-                    / (1.0 / rPlus + CI[i].res1->getConnectionDivisionTerm()
-                       + CI[i].res2->getConnectionDivisionTerm());
-                break;
-        }
-        if (std::isnan(force))
-            std::cout << "wait" << std::endl;
-        CI[i].res1->addForce (-force, CI[i].loc1, 1.0);
-        CI[i].res2->addForce (force, CI[i].loc2, 1.0);
+        solveConnection (i);
     }
     
 }
 
+void Instrument::solveConnection (int i)
+{
+    double K1 = CI[i].K1;
+    double K3 = CI[i].K3;
+    double R = CI[i].R;
+    double force = 0;
+    
+    CI[i].etaNext = CI[i].res1->getStateAt (CI[i].loc1, 0) - CI[i].res2->getStateAt (CI[i].loc2, 0);
+    CI[i].eta = CI[i].res1->getStateAt (CI[i].loc1, 1) - CI[i].res2->getStateAt (CI[i].loc2, 1);
+    CI[i].etaPrev = CI[i].res1->getStateAt (CI[i].loc1, 2) - CI[i].res2->getStateAt (CI[i].loc2, 2);
+    
+    double rPlus = 0.5 * K1 + 0.5 * K3 * CI[i].eta * CI[i].eta + 0.5 * fs * R;
+    double rMin = 0.5 * K1 + 0.5 * K3 * CI[i].eta * CI[i].eta - 0.5 * fs * R;
+    
+    switch (CI[i].connType)
+    {
+        case rigid:
+            force = CI[i].etaNext
+                / (CI[i].res1->getConnectionDivisionTerm() + CI[i].res2->getConnectionDivisionTerm());
+            break;
+        case linearSpring:
+//            force = (CI[i].etaNext + CI[i].etaPrev)
+//                / (2.0 / K1 + CI[i].res1->getConnectionDivisionTerm()
+//                   + CI[i].res2->getConnectionDivisionTerm());
+            force = (CI[i].etaNext + rMin / rPlus * CI[i].etaPrev)
+                / (1.0 / rPlus + CI[i].res1->getConnectionDivisionTerm()
+                   + CI[i].res2->getConnectionDivisionTerm());
+            break;
+        case nonlinearSpring:
+            force = (CI[i].etaNext + rMin / rPlus * CI[i].etaPrev)
+                / (1.0 / rPlus + CI[i].res1->getConnectionDivisionTerm()
+                   + CI[i].res2->getConnectionDivisionTerm());
+            break;
+    }
+    if (std::isnan(force))
+        RTLog::post (RTLogMessage::interactionForceIsNan, -1, i);
+    CI[i].res1->addForce (-force, CI[i].loc1, 1.0);
+    CI[i].res2->addForce (force, CI[i].loc2, 1.0);
+}
+
 void Instrument::excite()
 {
     for (auto res : resonators)
@@ -412,19 +483,210 @@ void Instrument::excite()
 void Instrument::update()
 {
     for (auto res : resonators)
-        res->update();
+        if (!res->isSleeping())
+            res->update();
 }
 
-float Instrument::getOutputL()
+void Instrument::checkSleepingModules()
 {
-    float outputL = 0.0f;
     for (auto res : resonators)
+        res->checkSleep();
+}
+
+bool Instrument::hasConnections (std::shared_ptr<ResonatorModule> res)
+{
+    for (auto& connection : CI)
+        if (connection.res1 == res || connection.res2 == res)
+            return true;
+    return false;
+}
+
+void Instrument::refreshPartitions()
+{
+    // the edits that happen while the partitions are calculated bump the generation again, so these partitions will not be used
+    uint32 generation = topologyGeneration.load();
+    int numResonators = static_cast<int> (resonators.size());
+    auto getResonatorIdx = [this] (const std::shared_ptr<ResonatorModule>& res) -> int {
+        for (int r = 0; r < resonators.size(); ++r)
+            if (resonators[r] == res)
+                return r;
+        return -1;
+    };
+    
+    // union-find over the resonators
+    std::vector<int> parent (numResonators);
+    for (int r = 0; r < numResonators; ++r)
+        parent[r] = r;
+    auto findRoot = [&parent] (int r) {
+        while (parent[r] != r)
+            r = parent[r] = parent[parent[r]];
+        return r;
+    };
+    
+    std::vector<int> connectionPartitionIdx (CI.size(), -1);
+    std::vector<std::pair<int, int>> connectionResonators (CI.size(), {-1, -1});
+    for (int i = 0; i < CI.size(); ++i)
+    {
+        if (!CI[i].connected)
+            continue;
+        connectionResonators[i] = {getResonatorIdx (CI[i].res1), getResonatorIdx (CI[i].res2)};
+        if (connectionResonators[i].first == -1 || connectionResonators[i].second == -1)
+            continue;
+        parent[findRoot (connectionResonators[i].first)] = findRoot (connectionResonators[i].second);
+    }
+    
+    PartitionSet newPartitionSet;
+    std::vector<int> partitionOfRoot (numResonators, -1);
+    for (int r = 0; r < numResonators; ++r)
     {
-        InOutInfo* IOinfo = res->getInOutInfo();
-        for (int i = 0; i < IOinfo->getNumOutputs(); ++i )
-            if (IOinfo->getOutChannelAt (i) == 0 || IOinfo->getOutChannelAt(i) == 2)
-                outputL += res->getOutput (IOinfo->getOutLocAt (i));
+        int root = findRoot (r);
+        if (partitionOfRoot[root] == -1)
+        {
+            partitionOfRoot[root] = static_cast<int> (newPartitionSet.partitions.size());
+            newPartitionSet.partitions.push_back (Partition());
+        }
+        newPartitionSet.partitions[partitionOfRoot[root]].resonators.push_back (resonators[r]);
     }
+    
+    for (int i = 0; i < CI.size(); ++i)
+    {
+        if (!CI[i].connected || connectionResonators[i].first == -1 || connectionResonators[i].second == -1)
+            continue;
+        connectionPartitionIdx[i] = partitionOfRoot[findRoot (connectionResonators[i].first)];
+        if (CI[i].connectionGroup == -1)
+            newPartitionSet.partitions[connectionPartitionIdx[i]].connections.push_back (i);
+    }
+    
+    // all connections of an overlapping group are in the same partition
+    for (int g = 0; g < CIOverlapVector.size(); ++g)
+    {
+        if (CIOverlapVector[g].size() == 0)
+            continue;
+        int idx = static_cast<int> (CIOverlapVector[g][0] - &CI[0]);
+        if (idx >= 0 && idx < CI.size() && connectionPartitionIdx[idx] != -1)
+            newPartitionSet.partitions[connectionPartitionIdx[idx]].overlapGroups.push_back (g);
+    }
+    
+    for (auto& partition : newPartitionSet.partitions)
+    {
+        partition.outputL.resize (Global::partitionChunkSize, 0.0f);
+        partition.outputR.resize (Global::partitionChunkSize, 0.0f);
+    }
+    newPartitionSet.generation = generation;
+    
+    // this also frees the partitions from before the previous refresh
+    const std::lock_guard<std::mutex> lock (partitionMutex);
+    pendingPartitionSet = std::move (newPartitionSet);
+    partitionsReady = true;
+}
+
+void Instrument::applyPartitions()
+{
+    if (!partitionsReady.load())
+        return;
+    
+    std::unique_lock<std::mutex> lock (partitionMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    
+    std::swap (partitionSet, pendingPartitionSet);
+    partitionsReady = false;
+}
+
+bool Instrument::canProcessPartitionsInParallel()
+{
+    return Global::enableParallelPartitions
+        && workerPool != nullptr && workerPool->getNumThreads() > 0
+        && applicationState == normalState
+        && partitionSet.partitions.size() > 1
+        && partitionSet.generation == topologyGeneration.load(); // stale if applyPartitions could not swap in the latest set yet
+}
+
+void Instrument::processPartitions (float* outputL, float* outputR, int numSamples)
+{
+    for (int start = 0; start < numSamples; start += Global::partitionChunkSize)
+    {
+        partitionJob.numSamples = std::min (Global::partitionChunkSize, numSamples - start);
+        workerPool->run (partitionJob, static_cast<int> (partitionSet.partitions.size()));
+        
+        // join the outputs in a fixed order so that the result does not depend on the scheduling
+        for (auto& partition : partitionSet.partitions)
+        {
+            for (int i = 0; i < partitionJob.numSamples; ++i)
+            {
+                outputL[start + i] += partition.outputL[i];
+                outputR[start + i] += partition.outputR[i];
+            }
+        }
+    }
+}
+
+void Instrument::processPartition (int partitionIdx, int numSamples)
+{
+    Partition& partition = partitionSet.partitions[partitionIdx];
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (auto& res : partition.resonators)
+            if (!res->isSleeping())
+                res->calculate();
+        
+        for (auto g : partition.overlapGroups)
+            solveOverlappingConnections (CIOverlapVector[g]);
+        for (auto c : partition.connections)
+            solveConnection (c);
+        
+        for (auto& res : partition.resonators)
+            if (res->getExcitationType() != noExcitation)
+                res->excite();
+        
+        float outL = 0.0f;
+        float outR = 0.0f;
+        for (auto& res : partition.resonators)
+        {
+            outL += getResonatorOutput (*res, 0);
+            outR += getResonatorOutput (*res, 1);
+        }
+        partition.outputL[i] = outL;
+        partition.outputR[i] = outR;
+        
+        for (auto& res : partition.resonators)
+            if (!res->isSleeping())
+                res->update();
+    }
+}
+
+void Instrument::repaintChangedResonators()
+{
+    bool shouldRepaintInstrument = false;
+    for (auto res : resonators)
+    {
+        // the (animated) exciters are always repainted
+        bool changed = res->hasVisualSnapshotChanged() || res->isExcitationActive();
+        if (!changed)
+            continue;
+        
+        if (CI.size() != 0)
+            shouldRepaintInstrument = true;
+        else
+            res->repaint();
+    }
+    // the connections are drawn by the instrument and move with the states
+    if (shouldRepaintInstrument)
+        repaint();
+}
+
+void Instrument::updateVisualSnapshots (int numSamples)
+{
+    for (auto res : resonators)
+        if (res->isModuleReady())
+            res->updateVisualSnapshot (numSamples);
+}
+
+float Instrument::getOutputL()
+{
+    float outputL = 0.0f;
+    for (auto res : resonators)
+        outputL += getResonatorOutput (*res, 0);
     return outputL;
 }
 
@@ -432,15 +694,20 @@ float Instrument::getOutputR()
 {
     float outputR = 0.0f;
     for (auto res : resonators)
-    {
-        InOutInfo* IOinfo = res->getInOutInfo();
-        for (int i = 0; i < IOinfo->getNumOutputs(); ++i )
-            if (IOinfo->getOutChannelAt (i) == 1 || IOinfo->getOutChannelAt(i) == 2)
-                outputR += res->getOutput (IOinfo->getOutLocAt (i));
-    }
+        outputR += getResonatorOutput (*res, 1);
     return outputR;
 }
 
+float Instrument::getResonatorOutput (ResonatorModule& res, int channel)
+{
+    float output = 0.0f;
+    InOutInfo* IOinfo = res.getInOutInfo();
+    for (int i = 0; i < IOinfo->getNumOutputs(); ++i )
+        if (IOinfo->getOutChannelAt (i) == channel || IOinfo->getOutChannelAt (i) == 2)
+            output += res.getOutput (IOinfo->getOutLocAt (i));
+    return output;
+}
+
 void Instrument::calcTotalEnergy()
 {
     prevEnergy = totEnergy;
@@ -485,6 +752,7 @@ void Instrument::mouseUp (const MouseEvent& e)
 #ifndef USE_EIGEN
     if (hasOverlap)
     {
+        topologyChanged();
         CI.erase (CI.begin() + connectionToMoveIdx);
         currentlyActiveConnection = nullptr;
     }
@@ -583,7 +851,10 @@ void Instrument::setApplicationState (ApplicationState a)
 {
     // if going back to the normal state without having finished making the connection
     if (applicationState == firstConnectionState && a == normalState)
+    {
+        topologyChanged();
         CI.pop_back();
+    }
     applicationState = a;
     switch (a) {
         case normalState:
@@ -600,6 +871,10 @@ void Instrument::setApplicationState (ApplicationState a)
     for (auto res : resonators)
         res->setApplicationState (a);
     
+    // the connections can only be changed outside of the normal state
+    if (a == normalState)
+        refreshPartitions();
+    
 //    switch (a)
 //    {
 //        case editConnectionState:
@@ -623,22 +898,14 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
 
         if (res.get() == changeBroadcaster)
         {
-            if (!res.get()->ableToInitialise())
+            currentlySelectedResonator = res;
+            if (res->getAction() == regridAction)
             {
-                resonatorToRemove = res;
-                NativeMessageBox::showMessageBoxAsync (AlertWindow::AlertIconType::WarningIcon, res->getErrorMsg(), "Please change your parameters", this, ModalCallbackFunction::create ([&] (int test){ test = 1; }));
-
-                removeResonatorModule();
-            } else {
-                currentlySelectedResonator = res;
-                if (res->getAction() == setStatesToZeroAction)
-                {
-                    action = setStatesToZeroAction;
-                    sendChangeMessage();
-                    res->setAction (noAction);
-                }
-                break;
+                // prepare the new grid off the message and audio threads
+                regridPool.addJob ([res] () { res->prepareRegrid(); });
+                res->setAction (noAction);
             }
+            break;
         }
     }
     // do not edit if this is not the currently highlighted instrument
@@ -656,6 +923,7 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
             switch (applicationState) {
                 case moveConnectionState:
                 {
+                    topologyChanged();
                     if (connectionToMoveIsFirst)
                         CI[connectionToMoveIdx].loc1 = res->getMouseLoc();
                     else
@@ -813,6 +1081,7 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
                                 if (xLocConn >= xLocClick - margin && xLocConn <= xLocClick + margin)
                                 {
                                     setCurrentlyActiveConnection (nullptr);
+                                    topologyChanged();
                                     CI.erase (CI.begin() + i);
                                     break;
                                 }
@@ -825,6 +1094,7 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
                                 if (xLocConn >= xLocClick - margin && xLocConn <= xLocClick + margin)
                                 {
                                     setCurrentlyActiveConnection (nullptr);
+                                    topologyChanged();
                                     CI.erase (CI.begin() + i);
                                     break;
                                 }
@@ -838,6 +1108,7 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
                 {
                     if (CI[CI.size()-1].res1 == res || res->getModifier() != ModifierKeys::leftButtonModifier + ModifierKeys::ctrlModifier) // clicked on the same component or rightclicked
                     {
+                        topologyChanged();
                         CI.pop_back();
                     }
                     else
@@ -849,7 +1120,10 @@ void Instrument::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
                         std::cout << "Has overlap: " << hasOverlap << std::endl;
 #ifndef USE_EIGEN
                         if (hasOverlap)
+                        {
+                            topologyChanged();
                             CI.pop_back();
+                        }
 #endif
                     }
                     
@@ -931,6 +1205,7 @@ void Instrument::resetTotalGridPoints()
 
 bool Instrument::resetOverlappingConnectionVectors()
 {
+    topologyChanged(); // the connection groups change
     // find the connections that are overlapping and do a linear system solve
     // also don't include any overlapping connections in the function that this calls
     
@@ -964,13 +1239,10 @@ bool Instrument::resetOverlappingConnectionVectors()
                 if (CI[i/2].connectionGroup != -1 && CI[j/2].connectionGroup != -1) // merge groups if both belong to one connection group
                 {
                     if (CI[i/2].connectionGroup == CI[j/2].connectionGroup)
-                    {
-                        std::cout << "Connection group is already merged" << std::endl;
                         continue;
-                    }
                     int groupToMerge = CI[i/2].connectionGroup;
                     int groupToMergeInto = CI[j/2].connectionGroup;
-                    std::cout << "Merging connection group " << groupToMerge << " into " << groupToMergeInto << std::endl;
+                    DBG ("Merging connection group " + String (groupToMerge) + " into " + String (groupToMergeInto));
                     for (int ii = 0; ii < CIgroupIndices[groupToMerge].size(); ++ii)
                     {
                         // change the connectiongroup from the connections in the second group to be that of the first one
@@ -996,23 +1268,21 @@ bool Instrument::resetOverlappingConnectionVectors()
                 }
                 else if (CI[i/2].connectionGroup != -1) // check if one of the connections is already part of a connection group
                 {
-                    std::cout << "CI " << (i/2) << " already has a connectiongroup, being " << CI[i/2].connectionGroup << std::endl;
                     CI[j/2].connectionGroup = CI[i/2].connectionGroup;
                     CIgroupIndices[CI[i/2].connectionGroup].push_back(j/2);
-                    std::cout << "CI " << (j/2) << " is now also part of connectiongroup " << CI[j/2].connectionGroup << std::endl;
+                    DBG ("CI " + String (j/2) + " is now also part of connectiongroup " + String (CI[j/2].connectionGroup));
 
                 }
                 else if (CI[j/2].connectionGroup != -1) // check if one of the connections is already part of a connection group
                 {
-                    std::cout << "CI " << (j/2) << " already has a connectiongroup, being " << CI[j/2].connectionGroup << std::endl;
                     CI[i/2].connectionGroup = CI[j/2].connectionGroup;
                     CIgroupIndices[CI[j/2].connectionGroup].push_back(i/2);
-                    std::cout << "CI " << (i/2) << " is now also part of connectiongroup " << CI[i/2].connectionGroup << std::endl;
+                    DBG ("CI " + String (i/2) + " is now also part of connectiongroup " + String (CI[i/2].connectionGroup));
 
                 }
                 else
                 {
-                    std::cout << "Adding new connection group with number " << curConnectionGroup << std::endl;
+                    DBG ("Adding new connection group with number " + String (curConnectionGroup));
                     CI[i/2].connectionGroup = curConnectionGroup;
                     CI[j/2].connectionGroup = curConnectionGroup;
                     CIgroupIndices.push_back({i/2, j/2});
@@ -1026,20 +1296,17 @@ bool Instrument::resetOverlappingConnectionVectors()
     // check whether the index of the connection groups match the index of the vector that they're stored in
     for (int i = 0; i < CIgroupIndices.size(); ++i)
         for (int j = 0; j < CIgroupIndices[i].size(); ++j)
-            if (CI[CIgroupIndices[i][j]].connectionGroup != i)
-                std::cout << "Connectiongroup does not match the index in the vector!!" << std::endl;
+            jassert (CI[CIgroupIndices[i][j]].connectionGroup == i);
 
-    
-    std::cout << "Results: " << std::endl;
+#if JUCE_DEBUG
     for (int i = 0; i < CIgroupIndices.size(); ++i)
     {
-        std::cout << "Connection group " << i << " has CI idcs: ";
+        String indices;
         for (int j = 0; j < CIgroupIndices[i].size(); ++j)
-        {
-            std::cout << CIgroupIndices[i][j] <<  " ";
-        }
-        std::cout << std::endl;
+            indices << CIgroupIndices[i][j] << " ";
+        DBG ("Connection group " + String (i) + " has CI idcs: " + indices);
     }
+#endif
     CIOverlapVector.clear();
     CIOverlapVector.reserve (CIgroupIndices.size());
     for (int i = 0; i < CIgroupIndices.size(); ++i)
@@ -1050,17 +1317,7 @@ bool Instrument::resetOverlappingConnectionVectors()
             CIOverlapVector[i][j] = &CI[CIgroupIndices[i][j]];
         }
     }
-    
-    std::cout << "Checking CI ptr vector" << std::endl;
-    for (int i = 0; i < CIOverlapVector.size(); ++i)
-    {
-        std::cout << "CIOverlapVector at idx " << i << " points to connections with connection group: ";
-        for (int j = 0; j < CIOverlapVector[i].size(); ++j)
-            std::cout << CIOverlapVector[i][j]->connectionGroup;
-        
-        std::cout << std::endl;
-
-    }
+    refreshPartitions();
     return hasOverlap;
 }
 
@@ -1132,13 +1389,13 @@ void Instrument::solveOverlappingConnections (std::vector<ConnectionInfo*>& CIO)
 //    solver.chol (IJminP);
 
     if(chol.info() != Success) {
-        std::cout << "decomposition failed" << std::endl;
+        RTLog::post (RTLogMessage::decompositionFailed);
         return;
     }
 
     VectorXd forces = chol.solve (b);
     if(chol.info() != Success) {
-        std::cout << "solving failed" << std::endl;
+        RTLog::post (RTLogMessage::solvingFailed);
         return;
     }
 
@@ -1202,6 +1459,8 @@ void Instrument::setConnectionType (ConnectionType c)
 
 void Instrument::addFirstConnection (std::shared_ptr<ResonatorModule> res, ConnectionType connType, double loc)
 {
+    res->requestSleep (false); // sleeping modules are not connected
+    topologyChanged();
     if (loc > 1) // then it's an integer (internal handling)
         CI.push_back (ConnectionInfo (connType, res, loc, res->getResonatorModuleType()));
     else // preset handling
@@ -1214,6 +1473,8 @@ void Instrument::addFirstConnection (std::shared_ptr<ResonatorModule> res, Conne
 
 void Instrument::addFirstConnection (std::shared_ptr<ResonatorModule> res, ConnectionType connType, double locX, double locY)
 {
+    res->requestSleep (false);
+    topologyChanged();
     if (locX > 1) // then it's an integer (internal handling)
         CI.push_back (ConnectionInfo (connType, res, locX, res->getResonatorModuleType()));
     else // preset handling
@@ -1226,6 +1487,8 @@ void Instrument::addFirstConnection (std::shared_ptr<ResonatorModule> res, Conne
 
 void Instrument::addSecondConnection (std::shared_ptr<ResonatorModule> res, double loc)
 {
+    res->requestSleep (false);
+    topologyChanged();
     if (loc > 1) // then it's an integer (internal handling)
         CI[CI.size()-1].setSecondResonatorParams (res, loc, res->getResonatorModuleType());
     else
@@ -1236,6 +1499,8 @@ void Instrument::addSecondConnection (std::shared_ptr<ResonatorModule> res, doub
 
 void Instrument::addSecondConnection (std::shared_ptr<ResonatorModule> res, double locX, double locY)
 {
+    res->requestSleep (false);
+    topologyChanged();
     if (locX > 1) // then it's an integer (internal handling)
         CI[CI.size()-1].setSecondResonatorParams (res, locX, res->getResonatorModuleType());
     else
@@ -1299,6 +1564,24 @@ void Instrument::virtualMouseMove2 (const double x, const double y)
     resonators[curMouseMoveResonator2]->myMouseMove (x, yRes, false);
 }
 
+void Instrument::applyRegrids()
+{
+    for (auto res : resonators)
+    {
+        if (!res->isRegridReady() || !res->applyRegrid())
+            continue;
+        
+        // move the connections to the closest point on the new grid
+        for (auto& C : CI)
+        {
+            if (C.res1 == res)
+                C.loc1 = res->getRegriddedLocation (C.loc1);
+            if (C.connected && C.res2 == res)
+                C.loc2 = res->getRegriddedLocation (C.loc2);
+        }
+    }
+}
+
 void Instrument::exitMouse2()
 {
     if (prevMouseMoveResonator2 != -1)
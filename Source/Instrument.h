@@ -13,6 +13,8 @@
 #include <JuceHeader.h>
 #include "Global.h"
 #include "InOutInfo.h"
+#include "DSPLoadMeter.h"
+#include "WorkerPool.h"
 #include "ResonatorModule.h"
 
 // include all types of resonator module here
@@ -30,7 +32,7 @@
 class Instrument  : public juce::Component, public ChangeBroadcaster, public ChangeListener
 {
 public:
-    Instrument (int fs);
+    Instrument (int fs, ProcessingMode processingMode = realTimeMode); // the processing mode is passed on to the resonator modules
     ~Instrument() override;
     
     // Vector storing information about the connections. [0] resonator index, [1] location
@@ -129,8 +131,14 @@ public:
     int getNumResonatorModules() { return (int)resonators.size(); };
     std::shared_ptr<ResonatorModule> getResonatorPtr (int idx) { return resonators[idx]; };
     
-    // Add/remove a resonator module
-    void addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo& inOutInfo, bool advanced);
+    /*  View. The resonator modules of an instrument only become its child components when the editor calls attachView (message thread) before it shows the instrument. Resonator modules that are added after that are added as child components straight away.
+        This only defers the component hierarchy: Instrument and ResonatorModule are still Components (and need the JUCE GUI classes, e.g., ScopedJuceInitialiser_GUI in the test executables). The background preset loader relies on JUCE allowing Components that are not on screen to be built off the message thread; there is no separate engine that can be used without JUCE GUI classes.
+     */
+    void attachView();
+    bool isViewAttached() { return viewAttached; };
+    
+    // Add/remove a resonator module. Returns false (and does not add the module) if its grid is invalid
+    bool addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo& inOutInfo, bool advanced);
     void removeResonatorModule();
     void removeAllResonators();
     void resetResonatorToRemove() { resonatorToRemove = nullptr; }; // just for visuals
@@ -139,9 +147,11 @@ public:
     
     // function called from within the addResonatorModule function
     void resetTotalGridPoints();
+    int getTotalGridPoints() { return totalGridPoints; };
 
-    // Calculate the schemes of each individual resonator module
-    void calculate();
+    // Calculate the schemes of each individual resonator module. timeModules adds the time of every module to the load meter (processBlock only does this for the timed samples).
+    void calculate (bool timeModules = false);
+    void calculateResonator (ResonatorModule& res, int numCores); // splits large 2D modules into row bands that are calculated on the worker pool
     
     // Solve interactions between resonator modules
     void solveInteractions();
@@ -152,6 +162,12 @@ public:
     // Update the resonator modules
     void update();
     
+    // Publish the states for the editor (after every block)
+    void updateVisualSnapshots (int numSamples);
+    
+    // Only repaints the resonator modules whose states changed visibly (the full instrument if it has connections)
+    void repaintChangedResonators();
+    
     // Returns the output of all modules
     float getOutputL();
     float getOutputR();
@@ -178,6 +194,7 @@ public:
     void setApplicationState (ApplicationState a);
     
     void setStatesToZero() { for (auto res : resonators) res->setStatesToZero(); }
+    bool takeStatesToZeroRequest(); // true if one of the exciters has blown up since the last call (audio thread)
     
     void changeListenerCallback (ChangeBroadcaster* changeBroadcaster) override;
     
@@ -211,6 +228,7 @@ public:
 
     bool resetOverlappingConnectionVectors();
     void solveOverlappingConnections (std::vector<ConnectionInfo*>& CIO); // Solve the connections that are overlapping
+    std::vector<std::vector<ConnectionInfo*>>& getOverlappingConnections() { return CIOverlapVector; }; // set by resetOverlappingConnectionVectors
     
     std::vector<ConnectionInfo>* getConnectionInfo() { return &CI; }; // for presets
         
@@ -250,6 +268,8 @@ public:
                 res->getHammerModule()->setControlLoc (vel);
     };
     
+    void setLoadMeter (DSPLoadMeter* l) { loadMeter = l; }; // to time the calculate function per resonator module type
+    
     // Resonator groups
     class ResonatorGroup
     {
@@ -306,11 +326,88 @@ public:
     std::vector<std::shared_ptr<ResonatorModule>>& getCurrentlyHoveredResonators() { return currentlyHoveredResonators; };
     
     void setBowParams(double newVel) { for (auto res : resonators) res->setBowParams(newVel); };
+    
+    // Swaps in the regridded resonator modules (if any). Should be called at the start of a block.
+    void applyRegrids();
+    
+    // Puts resonator modules to sleep or wakes them up (see ResonatorModule::checkSleep). Should be called at the start of a block.
+    void checkSleepingModules();
+    bool hasConnections (std::shared_ptr<ResonatorModule> res);
+    
+    /*  Parallel processing. The resonators and connections form a graph whose connected components (partitions) are fully independent, including their connection solves:
+            - refreshPartitions (message thread) recalculates the partitions whenever the resonators or connections change,
+            - applyPartitions (audio thread, at the start of a block) swaps them in,
+            - processPartitions (audio thread) runs the calculate, solve, excite and update pipeline of every partition as a task on the worker pool and adds the outputs of all partitions (in a fixed order) to outputL and outputR.
+     */
+    void refreshPartitions();
+    void applyPartitions();
+    bool canProcessPartitionsInParallel();
+    void processPartitions (float* outputL, float* outputR, int numSamples);
+    int getNumPartitions() { return static_cast<int> (partitionSet.partitions.size()); };
+    void setWorkerPool (WorkerPool* w) { workerPool = w; };
+    
+    // Modulates the tension, density and damping of all resonator modules. Should be called at the start of a block.
+    void modulateParameters (double tensionMultiplier, double densityMultiplier, double dampingMultiplier) { for (auto res : resonators) res->modulateParameters (tensionMultiplier, densityMultiplier, dampingMultiplier); };
+    
+    // Message thread. Requests the regrids that the modulation made necessary (see ResonatorModule::requestModulationRegrid).
+    void requestModulationRegrids() { for (auto res : resonators) res->requestModulationRegrid(); };
 
 private:
     
     int fs;
-    int totalGridPoints;
+    const ProcessingMode processingMode;
+    int totalGridPoints = 0;
+    
+    DSPLoadMeter* loadMeter = nullptr;
+    
+    void solveConnection (int idx); // solves a connection that is not part of an overlapping group
+    void processPartition (int partitionIdx, int numSamples);
+    static float getResonatorOutput (ResonatorModule& res, int channel); // 0 for left, 1 for right (outputs on both channels count for both)
+    
+    // Called before every edit of the resonators or connections (message thread, or the thread that builds the instrument), so that the audio thread does not use partitions that were calculated before it
+    void topologyChanged() { ++topologyGeneration; };
+    
+    struct Partition
+    {
+        std::vector<std::shared_ptr<ResonatorModule>> resonators;
+        std::vector<int> connections; // indices in CI of the connections that are not part of an overlapping group
+        std::vector<int> overlapGroups; // indices in CIOverlapVector
+        std::vector<float> outputL, outputR; // one chunk of Global::partitionChunkSize samples
+    };
+    
+    struct PartitionSet
+    {
+        std::vector<Partition> partitions;
+        
+        uint32 generation = 0; // the topology generation that the partitions were calculated for
+    };
+    
+    struct PartitionJob : public WorkerPool::Job
+    {
+        PartitionJob (Instrument& i) : instrument (i) {};
+        void runTask (int taskIdx) override { instrument.processPartition (taskIdx, numSamples); };
+        
+        Instrument& instrument;
+        int numSamples = 0;
+    };
+    
+    WorkerPool* workerPool = nullptr;
+    std::mutex partitionMutex; // only tried to lock on the audio thread
+    PartitionSet partitionSet;
+    PartitionSet pendingPartitionSet;
+    std::atomic<bool> partitionsReady { false };
+    std::atomic<uint32> topologyGeneration { 0 };
+    PartitionJob partitionJob { *this };
+    
+    struct BandJob : public WorkerPool::Job
+    {
+        void runTask (int taskIdx) override { res->calculateBand (taskIdx, numBands); };
+        
+        ResonatorModule* res = nullptr;
+        int numBands = 1;
+    };
+    
+    BandJob bandJob;
     
     std::vector<ConnectionInfo> CI;
     std::vector<std::vector<ConnectionInfo*>> CIOverlapVector; // a vector of groups of overlapping connections
@@ -323,11 +420,10 @@ private:
     bool painting = true;
     int resonatorModuleHeight = 0;
     bool highlightedInstrument = false;
+    bool viewAttached = false;
     
     ConnectionType currentConnectionType = rigid;
     
-    double K1, K3, R, rPlus, rMinus;
-    
     double prevEnergy = 0;
     double totEnergy = 0;
     
@@ -358,6 +454,9 @@ private:
     std::shared_ptr<ResonatorGroup> groupCurrentlyInteractingWith = nullptr;
     
     std::vector<std::shared_ptr<ResonatorModule>> currentlyHoveredResonators;
+    
+    // Background thread preparing the regrids of the resonator modules (declared last so that it is destroyed first)
+    ThreadPool regridPool { 1 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Instrument)
 };
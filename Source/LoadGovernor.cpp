@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+
+    LoadGovernor.cpp
+    Created: 19 Oct 2026 11:46:38pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "LoadGovernor.h"
+#include "PluginProcessor.h"
+
+LoadGovernor::LoadGovernor (ModularVSTAudioProcessor& processor) : processor (processor)
+{
+    if (Global::enableLoadGovernor)
+        startTimer (Global::governorInterval);
+}
+
+LoadGovernor::~LoadGovernor()
+{
+    stopTimer();
+}
+
+void LoadGovernor::timerCallback()
+{
+    // offline, the load can exceed 100% without dropouts
+    if (!processor.getLoadMeter().isEnabled() || processor.isNonRealtime())
+        return;
+    
+    // a new instrument (e.g., after loading a preset) starts at full quality
+    std::shared_ptr<Instrument> instrument = processor.getCurrentlyActiveInstrument();
+    if (instrument != currentInstrument)
+    {
+        steps.clear();
+        currentInstrument = instrument;
+        nothingLeftToShed = false;
+        recoverTime = Global::governorRecoverTime;
+        lastRestoreTime = -1.0;
+    }
+    if (instrument == nullptr)
+        return;
+    
+    float load = processor.getLoadMeter().getSmoothedLoad();
+    double now = Time::getMillisecondCounterHiRes();
+    
+    // the last restore did not overload the callback
+    if (lastRestoreTime >= 0.0 && now - lastRestoreTime >= Global::governorRestoreProbation)
+    {
+        lastRestoreTime = -1.0;
+        recoverTime = Global::governorRecoverTime;
+    }
+    
+    if (load > Global::governorHighLoad)
+    {
+        lowSince = -1.0;
+        if (highSince < 0.0)
+            highSince = now;
+        else if (now - highSince >= Global::governorHoldTime)
+        {
+            shedLoad (instrument, now);
+            highSince = now; // give the step time to take effect before taking the next one
+        }
+    }
+    else if (load < Global::governorLowLoad)
+    {
+        highSince = -1.0;
+        if (lowSince < 0.0)
+            lowSince = now;
+        else if (now - lowSince >= recoverTime && steps.size() != 0)
+        {
+            restoreLoad (now);
+            lowSince = now;
+        }
+    }
+    else
+    {
+        highSince = -1.0;
+        lowSince = -1.0;
+    }
+}
+
+bool LoadGovernor::shedLoad (std::shared_ptr<Instrument> instrument, double now)
+{
+    // overloaded again shortly after a restore: back off before trying that restore again
+    if (lastRestoreTime >= 0.0 && now - lastRestoreTime < Global::governorRestoreProbation)
+    {
+        recoverTime = std::min (2.0 * recoverTime, Global::governorMaxRecoverTime);
+        lastRestoreTime = -1.0;
+        addToReport ("The last restore overloaded, waiting " + String (recoverTime / 1000.0, 1) + " s before the next one");
+    }
+    
+    for (int i = 0; i < Global::numGovernorPolicyActions; ++i)
+        if (applyAction (Global::governorPolicy[i], instrument))
+            return true;
+    
+    if (!nothingLeftToShed)
+        addToReport ("Overloaded, but there is nothing left to shed");
+    nothingLeftToShed = true;
+    return false;
+}
+
+bool LoadGovernor::applyAction (LoadSheddingAction action, std::shared_ptr<Instrument> instrument)
+{
+    switch (action)
+    {
+        case sleepQuietModuleAction:
+        {
+            // the level is relative to the loudest module, so that a module that is still ringing (but much quieter than the rest) can be put to sleep
+            double loudestState = 0.0;
+            for (int r = 0; r < instrument->getNumResonatorModules(); ++r)
+            {
+                std::shared_ptr<ResonatorModule> res = instrument->getResonatorPtr (r);
+                if (res->isModuleReady() && !res->isSleeping())
+                    loudestState = std::max (loudestState, getMaxAbsState (res));
+            }
+            if (loudestState <= 0.0 || loudestState == std::numeric_limits<double>::max())
+                return false;
+            
+            std::shared_ptr<ResonatorModule> quietestRes = nullptr;
+            double quietestState = Global::governorSleepLevel * loudestState;
+            for (int r = 0; r < instrument->getNumResonatorModules(); ++r)
+            {
+                std::shared_ptr<ResonatorModule> res = instrument->getResonatorPtr (r);
+                if (!res->isModuleReady() || res->isSleepRequested() || res->isExcitationActive() || instrument->hasConnections (res))
+                    continue;
+                
+                double maxAbsState = getMaxAbsState (res);
+                if (maxAbsState < quietestState)
+                {
+                    quietestState = maxAbsState;
+                    quietestRes = res;
+                }
+            }
+            if (quietestRes == nullptr)
+                return false;
+            
+            quietestRes->requestSleep (true);
+            steps.push_back ({action, quietestRes});
+            addToReport ("Put resonator " + String (quietestRes->getID()) + " to sleep");
+            return true;
+        }
+        case reduce2DResolutionAction:
+        {
+            std::shared_ptr<ResonatorModule> largestRes = nullptr;
+            int largestNumPoints = Global::governorMinPoints2D;
+            for (int r = 0; r < instrument->getNumResonatorModules(); ++r)
+            {
+                std::shared_ptr<ResonatorModule> res = instrument->getResonatorPtr (r);
+                if (!res->isModuleReady() || res->isModule1D() || res->getNumPoints() <= largestNumPoints)
+                    continue;
+                largestNumPoints = res->getNumPoints();
+                largestRes = res;
+            }
+            if (largestRes == nullptr)
+                return false;
+            
+            int newLimit = std::max (Global::governorMinPoints2D, static_cast<int> (largestNumPoints * Global::governorMaxPointsFactor));
+            steps.push_back ({action, largestRes, largestRes->getMaxPointsLimit()});
+            largestRes->setMaxPointsLimit (newLimit);
+            largestRes->requestRegrid (largestRes->getParameters());
+            addToReport ("Reduced resonator " + String (largestRes->getID()) + " from " + String (largestNumPoints) + " to at most " + String (newLimit) + " points");
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void LoadGovernor::restoreLoad (double now)
+{
+    Step step = steps.back();
+    steps.pop_back();
+    nothingLeftToShed = false;
+    lastRestoreTime = now;
+    
+    std::shared_ptr<ResonatorModule> res = step.res.lock();
+    if (res == nullptr) // removed in the meantime
+        return;
+    
+    switch (step.action)
+    {
+        case sleepQuietModuleAction:
+            res->requestSleep (false);
+            addToReport ("Woke up resonator " + String (res->getID()));
+            break;
+        case reduce2DResolutionAction:
+            res->setMaxPointsLimit (step.prevMaxPointsLimit);
+            res->requestRegrid (res->getParameters());
+            addToReport ("Restored the resolution of resonator " + String (res->getID()));
+            break;
+        default:
+            break;
+    }
+}
+
+void LoadGovernor::addToReport (const String& message)
+{
+    String entry = Time::getCurrentTime().toString (false, true) + " " + message;
+    DBG ("Load governor: " + entry);
+    report.add (entry);
+    if (report.size() > Global::governorReportSize)
+        report.remove (0);
+}
+
+double LoadGovernor::getMaxAbsState (std::shared_ptr<ResonatorModule> res)
+{
+    const VisualSnapshot::Frame& frame = res->getVisualFrame();
+    if (!frame.hasData())
+        return std::numeric_limits<double>::max();
+    
+    double maxAbsState = 0.0;
+    for (int i = 0; i < frame.getNumValues(); ++i)
+        maxAbsState = std::max (maxAbsState, std::abs (frame.values[i]));
+    return maxAbsState;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    LoadGovernor.h
+    Created: 19 Oct 2026 11:46:38pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+#include "Instrument.h"
+
+class ModularVSTAudioProcessor;
+
+/*  Sheds load when the audio callback gets close to its deadline and restores it when there is room again (message thread).
+ 
+    When the smoothed load of the DSP load meter stays above Global::governorHighLoad for Global::governorHoldTime, one step is taken: the first action of Global::governorPolicy that can still do something is applied to the active instrument:
+        - sleepQuietModuleAction puts the quietest unconnected, non-excited module to sleep if it is below Global::governorSleepLevel relative to the loudest module of the instrument,
+        - reduce2DResolutionAction lowers the maximum number of grid points of the largest 2D module through a background regrid.
+    When the load stays below Global::governorLowLoad for the recover time (initially Global::governorRecoverTime), the last step is undone. If load has to be shed again within Global::governorRestoreProbation of a restore, that restore overloaded the callback and the recover time is doubled (up to Global::governorMaxRecoverTime) so that the governor does not keep oscillating between shedding and restoring the same step. A restore that survives the probation resets the recover time. All steps are logged for the report.
+ */
+class LoadGovernor : public Timer
+{
+public:
+    LoadGovernor (ModularVSTAudioProcessor& processor);
+    ~LoadGovernor() override;
+    
+    void timerCallback() override;
+    
+    int getNumSteps() { return static_cast<int> (steps.size()); };
+    StringArray getReport() { return report; }; // most recent step last
+    
+private:
+    struct Step
+    {
+        LoadSheddingAction action;
+        std::weak_ptr<ResonatorModule> res;
+        int prevMaxPointsLimit = -1;
+    };
+    
+    bool shedLoad (std::shared_ptr<Instrument> instrument, double now);
+    bool applyAction (LoadSheddingAction action, std::shared_ptr<Instrument> instrument);
+    void restoreLoad (double now);
+    void addToReport (const String& message);
+    
+    static double getMaxAbsState (std::shared_ptr<ResonatorModule> res);
+    
+    ModularVSTAudioProcessor& processor;
+    std::shared_ptr<Instrument> currentInstrument;
+    std::vector<Step> steps;
+    StringArray report;
+    
+    double highSince = -1.0; // in ms, -1 if the load is not above governorHighLoad
+    double lowSince = -1.0;
+    bool nothingLeftToShed = false;
+    
+    double recoverTime = Global::governorRecoverTime; // in ms, doubled after every restore that overloaded
+    double lastRestoreTime = -1.0; // in ms, -1 if the last restore has passed its probation
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoadGovernor)
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    LoadMeterOverlay.cpp
+    Created: 19 Oct 2026 7:48:02pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LoadMeterOverlay.h"
+
+//==============================================================================
+LoadMeterOverlay::LoadMeterOverlay (DSPLoadMeter& loadMeter) : loadMeter (loadMeter)
+{
+    // only shows information
+    setInterceptsMouseClicks (false, false);
+}
+
+LoadMeterOverlay::~LoadMeterOverlay()
+{
+}
+
+void LoadMeterOverlay::paint (juce::Graphics& g)
+{
+    g.fillAll (Colours::black.withAlpha (0.6f));
+    g.setColour (Colours::white);
+    g.setFont (12.0f);
+    
+    if (!loadMeter.isEnabled())
+    {
+        g.drawText ("Load meter disabled", getLocalBounds(), Justification::centred);
+        return;
+    }
+    
+    Rectangle<int> area = getLocalBounds().reduced (Global::margin / 2);
+    int lineHeight = area.getHeight() / (DSPLoadMeter::numStages + (loadGovernor == nullptr ? 2 : 3));
+    
+    // load against the block deadline
+    DSPLoadMeter::Statistics load = loadMeter.getLoadStatistics();
+    g.setColour (load.max >= 1.0 ? Colours::red : (load.p99 >= 0.7 ? Colours::orange : Colours::limegreen));
+    g.drawText ("Load: " + String (100.0 * load.mean, 1) + "% (p99 " + String (100.0 * load.p99, 1) + "%, max " + String (100.0 * load.max, 1) + "%)",
+                area.removeFromTop (lineHeight), Justification::centredLeft);
+    
+    g.setColour (Colours::white);
+    g.drawText ("Stage (us/block): mean / p99 / max", area.removeFromTop (lineHeight), Justification::centredLeft);
+    for (int s = 0; s < DSPLoadMeter::numStages; ++s)
+    {
+        DSPLoadMeter::Statistics stats = loadMeter.getStageStatistics (instrumentIdx, static_cast<DSPLoadMeter::Stage> (s));
+        g.drawText (String (DSPLoadMeter::getStageName (static_cast<DSPLoadMeter::Stage> (s))) + ": "
+                    + String (stats.mean, 1) + " / " + String (stats.p99, 1) + " / " + String (stats.max, 1),
+                    area.removeFromTop (lineHeight), Justification::centredLeft);
+    }
+    
+    // what the load governor has shed (if anything)
+    if (loadGovernor != nullptr)
+    {
+        StringArray report = loadGovernor->getReport();
+        g.setColour (loadGovernor->getNumSteps() == 0 ? Colours::white : Colours::orange);
+        g.drawText ("Governor: " + String (loadGovernor->getNumSteps()) + " step(s)" + (report.size() == 0 ? "" : ", " + report[report.size() - 1]),
+                    area.removeFromTop (lineHeight), Justification::centredLeft);
+    }
+}
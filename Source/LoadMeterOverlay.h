@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    LoadMeterOverlay.h
+    Created: 19 Oct 2026 7:48:02pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Global.h"
+#include "DSPLoadMeter.h"
+#include "LoadGovernor.h"
+
+//==============================================================================
+/*
+    Small overlay showing the statistics of the DSP load meter (callback load and time per stage of the active instrument)
+*/
+class LoadMeterOverlay  : public juce::Component
+{
+public:
+    LoadMeterOverlay (DSPLoadMeter& loadMeter);
+    ~LoadMeterOverlay() override;
+
+    void paint (juce::Graphics&) override;
+    
+    void setInstrumentIdx (int i) { instrumentIdx = i; };
+    void setLoadGovernor (LoadGovernor* g) { loadGovernor = g; };
+
+private:
+    DSPLoadMeter& loadMeter;
+    int instrumentIdx = 0;
+    LoadGovernor* loadGovernor = nullptr;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoadMeterOverlay)
+};
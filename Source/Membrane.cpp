@@ -12,7 +12,7 @@
 #include "Membrane.h"
 
 //==============================================================================
-Membrane::Membrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo, BoundaryCondition bc) : StiffMembrane (rmt, parameters, advanced, fs, ID, instrument, inOutInfo, bc)
+Membrane::Membrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo, BoundaryCondition bc) : StiffMembrane (rmt, parameters, advanced, fs, ID, instrument, processingMode, inOutInfo, bc)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -23,30 +23,15 @@ Membrane::~Membrane()
 {
 }
 
-void Membrane::calculate()
+#ifdef KERNEL_EQUIVALENCE_CHECK
+void Membrane::calculateReference()
 {
-    for (int m = 1; m < Ny; ++m) // clamped boundaries
-    {
-        for (int l = 1; l < Nx; ++l) // clamped boundaries
-        {
+    for (int m = 1; m < Ny; ++m)
+        for (int l = 1; l < Nx; ++l)
             u[0][l + m*Nx] =
                   B0 * u[1][l + m*Nx]
                 + B1 * (u[1][l+1 + m*Nx] + u[1][l-1 + m*Nx] + u[1][l + (m+1)*Nx] + u[1][l + (m-1)*Nx])
                 + C0 * u[2][l + m*Nx]
                 + C1 * (u[2][l+1 + m*Nx] + u[2][l-1 + m*Nx] + u[2][l + (m+1)*Nx] + u[2][l + (m-1)*Nx]);
-
-#ifdef SAVE_OUTPUT
-            statesSave << u[1][l + m*Nx] << ",";
-#endif
-            
-        }
-#ifdef SAVE_OUTPUT
-        statesSave << ";\n";
-#endif
-    }
-#ifdef SAVE_OUTPUT
-    ++counter;
-    if (counter >= samplesToRecord)
-        statesSave.close();
-#endif
 }
+#endif
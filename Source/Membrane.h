@@ -21,10 +21,12 @@
 class Membrane  : public StiffMembrane
 {
 public:
-    Membrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = simplySupportedBC);
+    Membrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = simplySupportedBC);
     ~Membrane() override;
     
-    void calculate() override;
+#ifdef KERNEL_EQUIVALENCE_CHECK
+    void calculateReference() override;
+#endif
     
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Membrane)
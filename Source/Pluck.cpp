@@ -91,6 +91,15 @@ void Pluck::drawExciter (Graphics& g)
 }
 
 void Pluck::initialise (NamedValueSet& parametersFromResonator)
+{
+    refreshParameters (parametersFromResonator);
+    
+    controlParameter = 6;
+    
+    moduleIsReady = true;
+}
+
+void Pluck::refreshParameters (NamedValueSet& parametersFromResonator)
 {
     h = *parametersFromResonator.getVarPointer ("h");
     rho = *parametersFromResonator.getVarPointer ("rho");
@@ -111,13 +120,9 @@ void Pluck::initialise (NamedValueSet& parametersFromResonator)
     C1 *= Adiv;
     
     Jterm = k * k / (rho * AorH * (1.0 + sig0 * k)); // connection division term without division by h
-    
-    controlParameter = 6;
-    
-    moduleIsReady = true;
 }
 
-void Pluck::calculate (std::vector<double*>& u)
+void Pluck::calculate (double** u)
 {
     force = K * (-controlLoc + 0.5) / (Global::stringVisualScaling);
     
@@ -175,7 +180,7 @@ void Pluck::calculate (std::vector<double*>& u)
 //        std::cout << std::endl;
     }
     if (std::isnan(IJ))
-        DBG("wait what?");
+        RTLog::post (RTLogMessage::exciterInterpolationIsNan, getID());
     eta = w - uI;
     etaPrev = wPrev - uIPrev;
 
@@ -205,7 +210,7 @@ void Pluck::calculate (std::vector<double*>& u)
             g = -2 * psiPrev / (etaStar - etaPrev);
     } else {
         g = kappaG * sqrt (Kc * (alphaC + 1.0) / 2.0) * pow(eta, (alphaC - 1.0) / 2.0);
-        DBG(g);
+        RTLog::post (RTLogMessage::exciterStiffness, getID(), g);
     }
     // make sure g is not insanely big
     g = Global::limit (g, 0, 500);
@@ -246,21 +251,20 @@ void Pluck::calculate (std::vector<double*>& u)
 
     if (force > 100)
     {
-        std::cout << "Details: " << "etaStar - etaPrev: " << etaStar - etaPrev << " g: " << g << std::endl;
+        RTLog::post (RTLogMessage::exciterForceTooLarge, getID(), etaStar - etaPrev, g);
         wNext = 0;
         w = 0;
         wPrev = 0;
         psi = 0;
         psiPrev = 0;
-        std::cout << "States are set to zero" << std::endl;
+        RTLog::post (RTLogMessage::exciterStatesReset, getID());
         setStatesToZero();
     }
     if (force / h > forceLimitOh && !plucked)
     {
-        std::cout << getID() << ": " << force << std::endl;
         Kc = 0;
         plucked = true;
-        DBG("plucked!");
+        RTLog::post (RTLogMessage::plucked, getID(), force);
     }
     
     if (plucked)
@@ -294,7 +298,7 @@ void Pluck::calculate (std::vector<double*>& u)
         psi = 0;
         psiPrev = 0;
         setStatesToZero();
-        DBG("wait");
+        RTLog::post (RTLogMessage::exciterStateIsNan, getID());
     }
     ++calcCounter;
     
@@ -339,11 +343,6 @@ double Pluck::getEnergy()
     return kinEnergy + potEnergy + totDampEnergy + collEnergy - totPowEnergy; // NOTE THE MINUS-SIGN FOR THE POWER
 }
 
-void Pluck::hiResTimerCallback()
-{
-    double lpCoeff = 0.99;
-}
-
 void Pluck::mouseEntered (const double x, const double y, int height)
 {
     if (isModule1D)
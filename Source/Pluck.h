@@ -25,12 +25,12 @@ public:
     void drawExciter (Graphics& g) override;
     
     void initialise (NamedValueSet& parameters) override;
-    void calculate (std::vector<double*>& u) override;
+    void refreshParameters (NamedValueSet& parameters) override;
+    void calculate (double** u) override;
     
     double getEnergy() override;
 
     void updateStates() override;
-    void hiResTimerCallback() override;
     
     void mouseEntered (const double x, const double y, int height) override;
     void mouseEntered1D (const double y, int height);
@@ -25,6 +25,13 @@ ModularVSTAudioProcessorEditor::ModularVSTAudioProcessorEditor (ModularVSTAudioP
     excitationPanel = std::make_unique<ExcitationPanel> (this);
     addAndMakeVisible (excitationPanel.get());
     
+    if (Global::showLoadMeter)
+    {
+        loadMeterOverlay = std::make_unique<LoadMeterOverlay> (audioProcessor.getLoadMeter());
+        loadMeterOverlay->setLoadGovernor (&audioProcessor.getLoadGovernor());
+        addAndMakeVisible (loadMeterOverlay.get());
+    }
+    
     // Window for adding modules
     addModuleWindow = std::make_unique<AddModuleWindow> (this);
     loadPresetWindow = std::make_unique<LoadPresetWindow>(this);
@@ -34,6 +41,7 @@ ModularVSTAudioProcessorEditor::ModularVSTAudioProcessorEditor (ModularVSTAudioP
     for (auto inst : instruments)
         if (inst->areModulesReady())
         {
+            inst->attachView();
             addAndMakeVisible (inst.get());
             audioProcessor.setCurrentlyActiveInstrument (inst);
             
@@ -62,6 +70,8 @@ ModularVSTAudioProcessorEditor::ModularVSTAudioProcessorEditor (ModularVSTAudioP
     // At what rate to refresh the states of the system
     startTimerHz (15);
     
+    // for toggling the trace capture
+    setWantsKeyboardFocus (true);
     
 #ifdef EDITOR_AND_SLIDERS
     parameters.reserve (8);
@@ -144,6 +154,12 @@ void ModularVSTAudioProcessorEditor::resized()
     int height = static_cast<float>(totalArea.getHeight())
                     / static_cast<float>(instruments.size());
     
+    if (loadMeterOverlay != nullptr)
+    {
+        loadMeterOverlay->setBounds (totalArea.getRight() - 260, totalArea.getY(), 260, 160);
+        loadMeterOverlay->toFront (false);
+    }
+    
     for (auto inst : instruments)
         if (inst->areModulesReady())
             inst->setBounds(totalArea.removeFromTop (height));
@@ -155,6 +171,7 @@ void ModularVSTAudioProcessorEditor::buttonClicked (Button* button)
 
 void ModularVSTAudioProcessorEditor::timerCallback()
 {
+    TraceCapture::Scope traceScope ("editorTimer");
     // LOOK AT THE CONTENTS OF THIS FUNCTION
     for (auto inst : instruments)
         if (inst->checkIfShouldRemoveResonatorModule())
@@ -179,7 +196,43 @@ void ModularVSTAudioProcessorEditor::timerCallback()
         refreshSliderValues();
 #endif
     
-    repaint();
+    if (loadMeterOverlay != nullptr)
+    {
+        loadMeterOverlay->setInstrumentIdx (audioProcessor.getCurrentlyActiveInstrumentIdx());
+        loadMeterOverlay->repaint();
+    }
+    
+    // while playing, only the resonator modules that visibly changed are repainted
+    if (applicationState == normalState)
+    {
+        for (auto inst : instruments)
+            inst->repaintChangedResonators();
+    }
+    else
+    {
+        repaint();
+    }
+}
+
+bool ModularVSTAudioProcessorEditor::keyPressed (const KeyPress& key)
+{
+    // cmd / ctrl + T starts and stops a trace capture, which is written to the desktop
+    if (key == KeyPress ('t', ModifierKeys::commandModifier, 0))
+    {
+        if (audioProcessor.isCapturingTrace())
+        {
+            File traceFile = File::getSpecialLocation (File::userDesktopDirectory).getNonexistentChildFile ("ModularVSTTrace", ".json");
+            if (audioProcessor.stopTraceCapture (traceFile))
+                DBG ("Trace written to " + traceFile.getFullPathName());
+        }
+        else
+        {
+            audioProcessor.startTraceCapture();
+            DBG ("Trace capture started");
+        }
+        return true;
+    }
+    return false;
 }
 
 void ModularVSTAudioProcessorEditor::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
@@ -219,6 +272,7 @@ void ModularVSTAudioProcessorEditor::changeListenerCallback (ChangeBroadcaster*
                     std::shared_ptr<Instrument> newInstrument = instruments[instruments.size()-1];
                     audioProcessor.setCurrentlyActiveInstrument (newInstrument);
                     controlPanel->setNumGroups (0);
+                    newInstrument->attachView();
                     addAndMakeVisible (newInstrument.get());
                     newInstrument->addChangeListener (this);
                     newInstrument->resized();
@@ -443,9 +497,6 @@ void ModularVSTAudioProcessorEditor::changeListenerCallback (ChangeBroadcaster*
                     case refreshEditorAction:
                         refresh();
                         break;
-                    case setStatesToZeroAction:
-                        audioProcessor.setStatesToZero (true);
-                        break;
                     case noAction:
                         break;
                     default:
@@ -462,6 +513,7 @@ void ModularVSTAudioProcessorEditor::refresh()
 {
     for (auto inst : instruments)
     {
+        inst->attachView();
         addAndMakeVisible (inst.get());
         inst->resized();
         inst->addChangeListener (this);
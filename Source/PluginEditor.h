@@ -15,6 +15,7 @@
 #include "ExcitationPanel.h"
 #include "AddModuleWindow.h"
 #include "LoadPresetWindow.h"
+#include "LoadMeterOverlay.h"
 #include <sys/stat.h>
 
 //==============================================================================
@@ -41,6 +42,7 @@ public:
     void buttonClicked (Button* button) override;
     void timerCallback() override;
     void changeListenerCallback (ChangeBroadcaster* changeBroadcaster) override;
+    bool keyPressed (const KeyPress& key) override;
 
     // Refresh
     void refresh();
@@ -75,6 +77,7 @@ private:
     // Various GUI panels
     std::unique_ptr<ControlPanel> controlPanel;
     std::unique_ptr<ExcitationPanel> excitationPanel;
+    std::unique_ptr<LoadMeterOverlay> loadMeterOverlay;
 
     // Window for adding modules
     std::unique_ptr<AddModuleWindow> addModuleWindow;
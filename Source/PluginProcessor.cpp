@@ -43,6 +43,10 @@ ModularVSTAudioProcessor::ModularVSTAudioProcessor()
                        )
 #endif
 {
+#if (BUILD_CONFIG == 2)
+    // log records from the audio thread end up in the Unity console
+    rtLog->setDestination (RTLogDestination::debugLog);
+#endif
 //#ifdef NO_EDITOR
     addParameter (mouseX1 = new AudioParameterFloat (customParameterID ("mouseX1"), "Mouse X1", 0, 0.99, 0.5));
     addParameter (mouseY1 = new AudioParameterFloat (customParameterID ("mouseY1"), "Mouse Y1", 0, 0.99, 0.5) );
@@ -61,10 +65,13 @@ ModularVSTAudioProcessor::ModularVSTAudioProcessor()
 #ifndef LOAD_ALL_UNITY_INSTRUMENTS
     addParameter (loadPresetToggle = new AudioParameterBool (customParameterID ("loadPresetToggle"), "Load preset", 1));
 #endif
+    addParameter (tension = new AudioParameterFloat (customParameterID ("tension"), "Tension", 0.25, 4.0, 1.0));
+    addParameter (density = new AudioParameterFloat (customParameterID ("density"), "Density", 0.25, 4.0, 1.0));
+    addParameter (damping = new AudioParameterFloat (customParameterID ("damping"), "Damping", 0.1, 10.0, 1.0));
     
     //#endif
 //#ifdef EDITOR_AND_SLIDERS
-    allParameters.reserve (8);
+    allParameters.reserve (static_cast<size_t> (getParameters().size())); // all parameters added above
     allParameters.push_back (mouseX1);
     allParameters.push_back (mouseY1);
     allParameters.push_back (mouseX2);
@@ -82,13 +89,16 @@ ModularVSTAudioProcessor::ModularVSTAudioProcessor()
 #ifndef LOAD_ALL_UNITY_INSTRUMENTS
     allParameters.push_back(loadPresetToggle);
 #endif
+    allParameters.push_back (tension);
+    allParameters.push_back (density);
+    allParameters.push_back (damping);
 //#endif
     sliderValues.resize (allParameters.size());
         
     
-    mouseSmoothValues1 = { *mouseX1, *mouseY1 };
-    mouseSmoothValues2 = { *mouseX2, *mouseY2 };
-    velocitySmoothValue = *velocity;
+    mouseSmoothers1 = { ControlSmoother (*mouseX1), ControlSmoother (*mouseY1) };
+    mouseSmoothers2 = { ControlSmoother (*mouseX2), ControlSmoother (*mouseY2) };
+    velocitySmoother.setValue (*velocity * 0.4 - 0.2);
 
     addChangeListener (this);
     
@@ -103,6 +113,8 @@ ModularVSTAudioProcessor::ModularVSTAudioProcessor()
     }
 #endif
     prevSliderValues = sliderValues;
+    
+    startTimer (Global::audioRequestPollInterval);
 
 //    std::cout << "Constructor processor" << std::endl;
 //    Debug::Log ("Debugger (constructor processor)", Color::Orange);
@@ -110,6 +122,7 @@ ModularVSTAudioProcessor::ModularVSTAudioProcessor()
 
 ModularVSTAudioProcessor::~ModularVSTAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -179,52 +192,29 @@ void ModularVSTAudioProcessor::prepareToPlay (double sampleRate, int samplesPerB
 {
     if (instruments.size() != 0)
     {
+        setCurrentlyActiveInstrument (nullptr);
+        const std::lock_guard<std::mutex> lock (loadedPresetMutex);
         instruments.clear();
         instruments.reserve (8);
     }
     fs = sampleRate;
-
-#ifdef LOAD_ALL_UNITY_INSTRUMENTS
-    totPreset = "<App>\n \t <Instrument id=\"i0\">\n";
-//    std::cout << totPreset << std::endl;
-    for (int i = 0; i < Global::presetFilesToIncludeInUnity.size(); ++i)
-    {
-        int sizeDummy = 0;
-        const char* name =  Global::presetFilesToIncludeInUnity[i].getCharPointer();
-        std::string st = BinaryData::getNamedResource(name, sizeDummy);
-        
-        // cut off app and instrument
-        size_t pos = st.find("\t \t <Resonator");
-        st.erase(0,pos);
-        pos = st.find("</App>");
-//        size_t stringSize = st.size();
-        st.erase(pos, st.size());
-        
-        totPreset += st;
-        if (i == Global::presetFilesToIncludeInUnity.size() - 1)
-            totPreset += "</App>";
-        else
-        {
-            totPreset += "\t <Instrument id=\"i" + String(i+1).toStdString() + "\">\n";
-        }
-    }
     
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_string (String(totPreset).getCharPointer());
-    loadPresetFromPugiDoc (&doc);
+    // the instruments are rebuilt below, so the grid limits of the processing mode apply to all modules
+    processingMode = isNonRealtime() ? offlineMode : realTimeMode;
     
-    switch (result.status)
+    // a session restored by the host replaces the preset that is loaded at startup
+    if (sessionPreset != nullptr)
     {
-        case pugi::status_ok:
-            debugLoadPresetResult (success);
-            break;
-        case pugi::status_file_not_found:
-            debugLoadPresetResult (fileNotFound);
-            break;
-        default:
-            debugLoadPresetResult (presetNotLoaded);
-            break;
+        restoreSessionState (false);
+        return;
     }
+
+#ifdef LOAD_ALL_UNITY_INSTRUMENTS
+    PresetData presetData;
+    PresetResult res = collectIncludedPresets (presetData);
+    if (res == success)
+        loadPresetFromPresetData (presetData);
+    debugLoadPresetResult (res);
     
 #else
     if (Global::loadPresetAtStartUp)
@@ -286,6 +276,7 @@ void ModularVSTAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
 {
     
     juce::ScopedNoDenormals noDenormals;
+    TraceCapture::Scope traceScope ("processBlock");
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -308,6 +299,12 @@ void ModularVSTAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     std::vector<float> totOutputR (buffer.getNumSamples(), 0.0f);
 
     std::vector<float* const*> curChannel {&channelData1, &channelData2};
+    
+    // the meter is only read once per block so that toggling it does not affect a block halfway
+    const bool meterEnabled = loadMeter.isEnabled();
+    int meteredInstrumentIdx = -1;
+    if (meterEnabled)
+        loadMeter.beginBlock (buffer.getNumSamples(), fs);
 #ifndef EDITOR_AND_SLIDERS
     for (int i = 0; i < sliderValues.size(); ++i)
     {
@@ -322,126 +319,218 @@ void ModularVSTAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     prevSliderValues = sliderValues;
 #endif
 
-    for (auto inst : instruments)
-        if (inst->shouldRemoveInOrOutput())
-            inst->removeInOrOutput();
+    // The instrument is published by the message thread (see setCurrentlyActiveInstrument) and can only change while the mutex is not held
+    audioMutex.lock();
+    Instrument* inst = audioInstrument.load();
+    if (inst != lastAudioInstrument)
+        switchAudioInstrument (inst);
+    
+    if (inst != nullptr && inst->shouldRemoveInOrOutput())
+        inst->removeInOrOutput();
+    
+    // an exciter blew up in the previous block
+    if (inst != nullptr && inst->takeStatesToZeroRequest())
+        setToZero = true;
     
     if (setToZero)
     {
-        for (auto inst : instruments)
+        if (inst != nullptr)
             inst->setStatesToZero();
+        resetControlSmoothers();
         if (applicationState == normalState)
             setToZero = false;
+        audioMutex.unlock();
         return;
     }
 
-    for (auto inst : instruments)
+    // check whether the instrument is ready
+    if (inst != nullptr && (!inst->areModulesReady() || applicationState == removeResonatorModuleState))
     {
-        if (inst != currentlyActiveInstrument)
-            continue;
+        // make sure that the exciters are moved again once the instrument is ready
+        resetControlSmoothers();
+        inst = nullptr;
+    }
+    
+    if (inst != nullptr)
+    {
+        meteredInstrumentIdx = audioInstrumentIdx.load();
         
-        audioMutex.lock();
-
-        // check whether the instrument is ready
-        if (!inst->areModulesReady() || applicationState == removeResonatorModuleState)
-        {
-            audioMutex.unlock();
-            continue;
-        }
-
-//        DBG("Lock mutex");
-
         inst->checkIfShouldExciteRaisedCos();
         
+        // swap in resonator modules that have been regridded on the background thread
+        TraceCapture::begin ("applyRegrids");
+        inst->applyRegrids();
+        TraceCapture::end ("applyRegrids");
+        
+        // modules that were put to sleep by the load governor
+        inst->checkSleepingModules();
+        
+        // connected components of the instrument that were recalculated on the message thread
+        inst->applyPartitions();
+        
+        // only refreshes the coefficients if the multipliers changed
+        TraceCapture::begin ("modulateParameters");
+        inst->modulateParameters (sliderValues[tensionID], sliderValues[densityID], sliderValues[dampingID]);
+        TraceCapture::end ("modulateParameters");
+        
+        // smoothing coefficients only need to be calculated once per block
+        bool smoothAtControlRate = sliderValues[smoothID] == 1 && sliderControl;
+        if (smoothAtControlRate)
+            refreshControlSmoothers();
+        else
+            resetControlSmoothers();
+        
 //        if (inst->checkIfShouldRemoveResonatorModule())
 //        {
 //            inst->removeResonatorModule();
 //            refreshEditor = true;
 //        }
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        // independent parts of the instrument are processed in parallel for the whole block (not possible when the exciters are moved during the block)
+        bool processInParallel = !smoothAtControlRate && inst->canProcessPartitionsInParallel();
+#if defined (CALC_ENERGY) || defined (SAVE_OUTPUT)
+        processInParallel = false;
+#endif
+        if (processInParallel)
+        {
+            TraceCapture::Scope partitionScope ("processPartitions");
+            int64 ticks = meterEnabled ? DSPLoadMeter::getTicks() : 0;
+            inst->processPartitions (totOutputL.data(), totOutputR.data(), buffer.getNumSamples());
+            if (meterEnabled)
+                loadMeter.addStageTime (DSPLoadMeter::parallelStage, ticks);
+        }
+        else
         {
-            inst->calculate();
-            inst->solveInteractions();
-            inst->excite();
+            TraceCapture::begin ("sampleLoop");
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                // only some samples are timed (see DSPLoadMeter)
+                const bool timeSample = meterEnabled && DSPLoadMeter::shouldTimeSample (i);
+                int64 ticks = timeSample ? DSPLoadMeter::getTicks() : 0;
+                inst->calculate (timeSample);
+                if (timeSample)
+                    ticks = loadMeter.addStageTime (DSPLoadMeter::calculateStage, ticks);
+                inst->solveInteractions();
+                if (timeSample)
+                    ticks = loadMeter.addStageTime (DSPLoadMeter::interactionStage, ticks);
+                inst->excite();
+                if (timeSample)
+                    ticks = loadMeter.addStageTime (DSPLoadMeter::exciteStage, ticks);
 #ifdef CALC_ENERGY
-            inst->calcTotalEnergy();
+                inst->calcTotalEnergy();
 //#ifdef CALC_ENERGY
-            std::cout << "Energy change: " << inst->getTotalEnergy() << std::endl;
+                std::cout << "Energy change: " << inst->getTotalEnergy() << std::endl;
 //#endif
 
 #endif
 #ifdef SAVE_OUTPUT
-            inst->saveOutput();
-            if (inst == instruments[0])
-                ++counter;
+                inst->saveOutput();
+                if (meteredInstrumentIdx == 0)
+                    ++counter;
 //            if (counter > Global::samplesToRecord + buffer.getNumSamples())
 //            {
 //                exit(0);
 //            }
 #endif
 
-            totOutputL[i] += inst->getOutputL();
-            totOutputR[i] += inst->getOutputR();
-            
-            // Update the states
-            inst->update();
-
-            // virtual mouse move at audio rate (smoothing)
-            if (sliderValues[smoothID] == 1 && sliderControl)
-            {
-
-                mouseSmoothValues1[0] = (0.99 + 0.0001 * sliderValues[smoothnessID]) * mouseSmoothValues1[0] + (1.0 - (0.99 + 0.0001 * sliderValues[smoothnessID])) * sliderValues[mouseX1ID];
-                mouseSmoothValues2[0] = (0.99 + 0.0001 * sliderValues[smoothnessID]) * mouseSmoothValues2[0] + (1.0 - (0.99 + 0.0001 * sliderValues[smoothnessID])) * sliderValues[mouseX2ID];
-//#ifndef LOAD_ALL_UNITY_INSTRUMENTS
-//                // If velocity is used, locate the mouse at a ylocation dependent on the velocity
-//                double yVal = (sliderValues[useVelocityID] && curExcitationType == hammer) ? (floor(sliderValues[mouseYID] * currentlyActiveInstrument->getNumResonatorModules()) + 0.5 - 0.5 * sliderValues[velocityID]) / currentlyActiveInstrument->getNumResonatorModules() : sliderValues[1];
-//#else
-                double yVal1 = 0;
-                double yVal2 = 0;
-                if (currentlyActiveInstrument != nullptr)
+#if defined (CALC_ENERGY) || defined (SAVE_OUTPUT)
+                if (timeSample)
+                    ticks = DSPLoadMeter::getTicks(); // do not include the diagnostics above
+#endif
+                totOutputL[i] += inst->getOutputL();
+                totOutputR[i] += inst->getOutputR();
+                if (timeSample)
+                    ticks = loadMeter.addStageTime (DSPLoadMeter::outputStage, ticks);
+
+                // Update the states
+                inst->update();
+                if (timeSample)
+                    ticks = loadMeter.addStageTime (DSPLoadMeter::updateStage, ticks);
+
+                // virtual mouse move at control rate (smoothing)
+                if (smoothAtControlRate)
                 {
-                    if (currentlyActiveInstrument->getCurrentlyHoveredResonators()[0] != nullptr &&
-                       currentlyActiveInstrument->getCurrentlyHoveredResonators()[0]->isModule1D())
+                    // advance the smoothers every controlRateInterval samples
+                    if (controlCounter == 0)
+                        stepControlSmoothers();
+
+                    ++controlCounter;
+                    double alpha = controlCounter / static_cast<double> (Global::controlRateInterval);
+                    if (controlCounter >= Global::controlRateInterval)
+                        controlCounter = 0;
+                
+                    double x1 = mouseSmoothers1[0].getValue (alpha);
+                    double y1 = mouseSmoothers1[1].getValue (alpha);
+                    if (mouseSmoothers1[0].shouldPush (x1) || mouseSmoothers1[1].shouldPush (y1))
                     {
-                        // If velocity is used for a 1D object, locate the mouse at a ylocation dependent on the velocity
-                        yVal1 = (sliderValues[useVelocityID] && curExcitationType == hammer) ? (floor(sliderValues[mouseY1ID] * currentlyActiveInstrument->getNumResonatorModules()) + 0.5 - 0.5 * sliderValues[velocityID]) / currentlyActiveInstrument->getNumResonatorModules() : sliderValues[mouseY1ID];
-                    } else {
-                        yVal1 = sliderValues[mouseY1ID];
+                        inst->virtualMouseMove1 (x1, y1);
+                        mouseSmoothers1[0].setPushed (x1);
+                        mouseSmoothers1[1].setPushed (y1);
                     }
-                    if (currentlyActiveInstrument->getCurrentlyHoveredResonators()[1] != nullptr &&
-                       currentlyActiveInstrument->getCurrentlyHoveredResonators()[1]->isModule1D())
+                
+                    if (sliderValues[activateSecondExciterID] >= 0.5f)
                     {
-                        yVal2 = (sliderValues[useVelocityID] && curExcitationType == hammer) ? (floor(sliderValues[mouseY2ID] * currentlyActiveInstrument->getNumResonatorModules()) + 0.5 - 0.5 * sliderValues[velocityID]) / currentlyActiveInstrument->getNumResonatorModules() : sliderValues[mouseY2ID];
-
-                    } else {
-                        yVal2 = sliderValues[mouseY2ID];
+                        double x2 = mouseSmoothers2[0].getValue (alpha);
+                        double y2 = mouseSmoothers2[1].getValue (alpha);
+                        if (mouseSmoothers2[0].shouldPush (x2) || mouseSmoothers2[1].shouldPush (y2))
+                        {
+                            inst->virtualMouseMove2 (x2, y2);
+                            mouseSmoothers2[0].setPushed (x2);
+                            mouseSmoothers2[1].setPushed (y2);
+                        }
                     }
-                }
-
                 
-//#endif
-                mouseSmoothValues1[1] = (0.99 + 0.0001 * sliderValues[smoothnessID]) * mouseSmoothValues1[1] + (1.0 - (0.99 + 0.0001 * sliderValues[smoothnessID])) * yVal1;
-                mouseSmoothValues2[1] = (0.99 + 0.0001 * sliderValues[smoothnessID]) * mouseSmoothValues2[1] + (1.0 - (0.99 + 0.0001 * sliderValues[smoothnessID])) * yVal2;
-                inst->virtualMouseMove1 (mouseSmoothValues1[0], mouseSmoothValues1[1]);
-                if (sliderValues[activateSecondExciterID] >= 0.5f)
-                    inst->virtualMouseMove2 (mouseSmoothValues2[0], mouseSmoothValues2[1]);
-
-                velocitySmoothValue = (0.99 + 0.0001 * sliderValues[smoothnessID]) * velocitySmoothValue + (1.0 - (0.99 + 0.0001 * sliderValues[smoothnessID])) * (sliderValues[velocityID] * 0.4 - 0.2);
-                if (sliderValues[excitationTypeID] >= 0.67f)
-                    inst->setBowParams (velocitySmoothValue);
-            } else
-            {
-                mouseSmoothValues1[0] = sliderValues[mouseX1ID];
-                mouseSmoothValues1[1] = sliderValues[mouseY1ID];
-                mouseSmoothValues2[0] = sliderValues[mouseX2ID];
-                mouseSmoothValues2[1] = sliderValues[mouseY2ID];
+                    if (sliderValues[excitationTypeID] >= 0.67f)
+                    {
+                        double vel = velocitySmoother.getValue (alpha);
+                        if (velocitySmoother.shouldPush (vel))
+                        {
+                            inst->setBowParams (vel);
+                            velocitySmoother.setPushed (vel);
+                        }
+                    }
+                    if (timeSample)
+                        loadMeter.addStageTime (DSPLoadMeter::smoothingStage, ticks);
+                }
             }
+            TraceCapture::end ("sampleLoop");
         }
+        
+        // the stages alternate every sample, so they are traced as counters (time per block)
+        if (meterEnabled && TraceCapture::isActive())
+            for (int s = 0; s < DSPLoadMeter::numStages; ++s)
+                TraceCapture::counter (DSPLoadMeter::getStageName (static_cast<DSPLoadMeter::Stage> (s)),
+                                       loadMeter.getBlockStageTime (static_cast<DSPLoadMeter::Stage> (s)));
     
-        audioMutex.unlock();
-//        DBG("Unlock mutex" + String(counter));
-
+        inst->updateVisualSnapshots (buffer.getNumSamples());
     }
+    audioMutex.unlock();
+//    DBG("Unlock mutex" + String(counter));
+    
+    // crossfade from the instrument that was active before a preset was swapped in
+    if (fadingOutInstrument != nullptr)
+    {
+        TraceCapture::Scope crossfadeScope ("crossfade");
+        for (int i = 0; i < buffer.getNumSamples() && crossfadeCounter < crossfadeLength; ++i)
+        {
+            double gain = 1.0 - static_cast<double> (crossfadeCounter) / crossfadeLength;
+            fadingOutInstrument->calculate();
+            fadingOutInstrument->solveInteractions();
+            fadingOutInstrument->excite();
+            totOutputL[i] = (1.0 - gain) * totOutputL[i] + gain * fadingOutInstrument->getOutputL();
+            totOutputR[i] = (1.0 - gain) * totOutputR[i] + gain * fadingOutInstrument->getOutputR();
+            fadingOutInstrument->update();
+            ++crossfadeCounter;
+        }
+        if (crossfadeCounter >= crossfadeLength)
+        {
+            fadingOutInstrument = nullptr;
+            presetSwapDone = true;
+        }
+    }
+    
+    // copy the states for the host session (see getStateInformation)
+    if (stateSnapshotRequested)
+        takeStateSnapshot();
     
     // limit output
     for (int channel = 0; channel < numChannels; ++channel)
@@ -459,15 +548,84 @@ void ModularVSTAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     }
     if (shouldLoadPreset)
     {
-        for (auto inst : instruments)
-            inst->unReadyAllModules();
-        sendChangeMessage();
+        // handled on the message thread (see timerCallback)
+        presetLoadRequested = true;
         shouldLoadPreset = false;
-        refreshEditor = true;
     }
 //    std::cout << totOutput[15] << std::endl;
 //    Debug::Log ("Hellow Orange", Color::Orange); // unity debug
+    
+    if (meterEnabled)
+        loadMeter.endBlock (meteredInstrumentIdx);
+
+}
+
+void ModularVSTAudioProcessor::refreshControlSmoothers()
+{
+    // raise the per-sample coefficient to the power of the interval to keep the same time-constant at control rate
+    double controlCoeff = pow (0.99 + 0.0001 * sliderValues[smoothnessID], Global::controlRateInterval);
+    for (int i = 0; i < 2; ++i)
+    {
+        mouseSmoothers1[i].setCoefficient (controlCoeff);
+        mouseSmoothers2[i].setCoefficient (controlCoeff);
+    }
+    velocitySmoother.setCoefficient (controlCoeff);
+    
+    // make sure that exciters get their position / parameters as soon as they are (re)activated
+    if (sliderValues[activateSecondExciterID] < 0.5f)
+        for (auto& smoother : mouseSmoothers2)
+            smoother.resetPushed();
+    
+    if (sliderValues[excitationTypeID] < 0.67f)
+        velocitySmoother.resetPushed();
+}
 
+void ModularVSTAudioProcessor::resetControlSmoothers()
+{
+    mouseSmoothers1[0].setValue (sliderValues[mouseX1ID]);
+    mouseSmoothers1[1].setValue (sliderValues[mouseY1ID]);
+    mouseSmoothers2[0].setValue (sliderValues[mouseX2ID]);
+    mouseSmoothers2[1].setValue (sliderValues[mouseY2ID]);
+    
+    // the mouse is moved directly from the parameter callbacks when not smoothing
+    for (int i = 0; i < 2; ++i)
+    {
+        mouseSmoothers1[i].resetPushed();
+        mouseSmoothers2[i].resetPushed();
+    }
+    velocitySmoother.resetPushed();
+    controlCounter = 0;
+}
+
+void ModularVSTAudioProcessor::stepControlSmoothers()
+{
+    double yVal1 = 0;
+    double yVal2 = 0;
+    if (lastAudioInstrument != nullptr)
+    {
+        if (lastAudioInstrument->getCurrentlyHoveredResonators()[0] != nullptr &&
+           lastAudioInstrument->getCurrentlyHoveredResonators()[0]->isModule1D())
+        {
+            // If velocity is used for a 1D object, locate the mouse at a ylocation dependent on the velocity
+            yVal1 = (sliderValues[useVelocityID] && curExcitationType == hammer) ? (floor(sliderValues[mouseY1ID] * lastAudioInstrument->getNumResonatorModules()) + 0.5 - 0.5 * sliderValues[velocityID]) / lastAudioInstrument->getNumResonatorModules() : sliderValues[mouseY1ID];
+        } else {
+            yVal1 = sliderValues[mouseY1ID];
+        }
+        if (lastAudioInstrument->getCurrentlyHoveredResonators()[1] != nullptr &&
+           lastAudioInstrument->getCurrentlyHoveredResonators()[1]->isModule1D())
+        {
+            yVal2 = (sliderValues[useVelocityID] && curExcitationType == hammer) ? (floor(sliderValues[mouseY2ID] * lastAudioInstrument->getNumResonatorModules()) + 0.5 - 0.5 * sliderValues[velocityID]) / lastAudioInstrument->getNumResonatorModules() : sliderValues[mouseY2ID];
+
+        } else {
+            yVal2 = sliderValues[mouseY2ID];
+        }
+    }
+    
+    mouseSmoothers1[0].step (sliderValues[mouseX1ID]);
+    mouseSmoothers1[1].step (yVal1);
+    mouseSmoothers2[0].step (sliderValues[mouseX2ID]);
+    mouseSmoothers2[1].step (yVal2);
+    velocitySmoother.step (sliderValues[velocityID] * 0.4 - 0.2);
 }
 
 //==============================================================================
@@ -488,15 +646,223 @@ juce::AudioProcessorEditor* ModularVSTAudioProcessor::createEditor()
 //==============================================================================
 void ModularVSTAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    MemoryOutputStream stream (destData, false);
+    stream.writeInt (sessionMagic);
+    stream.writeInt (sessionVersion);
+    
+    // all instruments as a binary preset (including the grid sizes)
+    PresetData presetData;
+    {
+        // hosts can call this from any thread, also while a preset is swapped in
+        const std::lock_guard<std::mutex> loadLock (loadPresetMutex);
+        const std::lock_guard<std::mutex> instrumentsLock (loadedPresetMutex);
+        presetData.readFromInstruments (instruments, fs);
+    }
+
+    MemoryOutputStream presetStream;
+    presetData.writeToBinary (presetStream);
+    stream.writeInt (static_cast<int> (presetStream.getDataSize()));
+    stream.write (presetStream.getData(), presetStream.getDataSize());
+    
+    // plugin parameters (normalised)
+    stream.writeInt (static_cast<int> (allParameters.size()));
+    for (auto parameter : allParameters)
+        stream.writeFloat (parameter->getValue());
+    
+    // states of the resonator modules
+    bool includeStates = Global::saveStatesInSession && requestStateSnapshot();
+    stream.writeBool (includeStates);
+    if (!includeStates)
+        return;
+    
+    const std::lock_guard<std::mutex> lock (stateSnapshotMutex);
+    auto& snapshot = stateSnapshots[stateSnapshotReadIdx];
+    stream.writeInt (static_cast<int> (snapshot.size()));
+    for (auto& resonatorStates : snapshot)
+    {
+        stream.writeInt (static_cast<int> (resonatorStates.size()));
+        stream.writeInt (resonatorStates.size() == 0 ? 0 : static_cast<int> (resonatorStates[0].size()));
+        for (auto& state : resonatorStates)
+            for (auto val : state)
+                stream.writeDouble (val);
+    }
 }
 
 void ModularVSTAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    if (!readSessionState (data, sizeInBytes))
+    {
+        DBG ("Session state could not be read");
+        return;
+    }
+    
+    // Before prepareToPlay has been called, the session is restored there (instead of the last saved preset). While a preset is being loaded, it is restored after the swap.
+    if (fs > 0 && !presetLoadInProgress)
+        restoreSessionState (true);
+    else if (fs > 0)
+        sessionRestorePending = true;
+}
+
+bool ModularVSTAudioProcessor::readSessionState (const void* data, int sizeInBytes)
+{
+    if (data == nullptr || sizeInBytes < static_cast<int> (3 * sizeof (int)))
+        return false;
+    
+    MemoryInputStream stream (data, static_cast<size_t> (sizeInBytes), false);
+    if (stream.readInt() != sessionMagic || stream.readInt() != sessionVersion)
+        return false;
+    
+    // the preset is read straight from the host's memory
+    int presetSize = stream.readInt();
+    if (presetSize <= 0 || presetSize > stream.getNumBytesRemaining())
+        return false;
+    
+    std::shared_ptr<PresetData> presetData = std::make_shared<PresetData>();
+    if (!presetData->readFromBinary (static_cast<const char*> (data) + stream.getPosition(), presetSize))
+        return false;
+    stream.skipNextBytes (presetSize);
+    
+    int numParameters = stream.readInt();
+    if (numParameters < 0 || numParameters * sizeof (float) > stream.getNumBytesRemaining())
+        return false;
+    for (int i = 0; i < numParameters; ++i)
+    {
+        float value = stream.readFloat();
+        if (i < allParameters.size())
+            allParameters[i]->setValueNotifyingHost (value);
+    }
+    
+    std::vector<std::vector<std::vector<double>>> states;
+    if (stream.readBool())
+    {
+        int numResonators = stream.readInt();
+        if (numResonators < 0 || numResonators * 2 * sizeof (int) > stream.getNumBytesRemaining())
+            return false;
+        states.resize (numResonators);
+        for (auto& resonatorStates : states)
+        {
+            int numStateVectors = stream.readInt();
+            int stateVectorSize = stream.readInt();
+            if (numStateVectors < 0 || stateVectorSize < 0
+                || static_cast<int64> (numStateVectors) * stateVectorSize * sizeof (double) > stream.getNumBytesRemaining())
+                return false;
+            
+            resonatorStates.resize (numStateVectors, std::vector<double> (stateVectorSize, 0.0));
+            for (auto& state : resonatorStates)
+                for (auto& val : state)
+                    val = stream.readDouble();
+        }
+    }
+    
+    sessionPreset = presetData;
+    sessionStates.swap (states);
+    return true;
+}
+
+void ModularVSTAudioProcessor::restoreSessionState (bool swapInAtBlockStart)
+{
+    // the preset is kept to rebuild the instruments in later calls of prepareToPlay, the states are only restored once
+    std::shared_ptr<const PresetData> presetData = sessionPreset;
+    std::vector<std::vector<std::vector<double>>> states;
+    states.swap (sessionStates);
+    sessionRestorePending = false;
+    
+    std::vector<std::shared_ptr<Instrument>> newInstruments;
+    newInstruments.reserve (8);
+    if (!buildInstrumentsFromPresetData (*presetData, newInstruments))
+    {
+        // keep the current instruments, as when an asynchronously loaded preset fails
+        debugLoadPresetResult (presetNotLoaded);
+        return;
+    }
+    
+    // the states can only be used if the grids are the same
+    if (presetData->fs == fs)
+    {
+        int idx = 0;
+        for (auto inst : newInstruments)
+            for (int r = 0; r < inst->getNumResonatorModules() && idx < states.size(); ++r)
+                if (!inst->getResonatorPtr (r)->setStatesFrom (states[idx++]))
+                    DBG ("States of resonator " + String (r) + " could not be restored");
+    }
+    
+    if (swapInAtBlockStart)
+    {
+        presetLoadInProgress = true;
+        const std::lock_guard<std::mutex> lock (loadedPresetMutex);
+        loadedInstruments.swap (newInstruments);
+        loadedPresetReady = true;
+        return;
+    }
+    
+    loadPresetMutex.lock();
+    {
+        const std::lock_guard<std::mutex> lock (loadedPresetMutex);
+        instruments.swap (newInstruments);
+        if (instruments.size() != 0)
+            setCurrentlyActiveInstrument (instruments[instruments.size()-1]);
+    }
+    refreshEditor = true;
+    loadPresetMutex.unlock();
+}
+
+bool ModularVSTAudioProcessor::requestStateSnapshot()
+{
+    {
+        const std::lock_guard<std::mutex> lock (stateSnapshotMutex);
+        
+        // allocate the buffer that the audio thread copies into
+        auto& snapshot = stateSnapshots[1 - stateSnapshotReadIdx];
+        snapshot.clear();
+        snapshotResonators.clear();
+        
+        // the instruments can be swapped out by a preset load while the host saves the session
+        const std::lock_guard<std::mutex> loadLock (loadPresetMutex);
+        const std::lock_guard<std::mutex> instrumentsLock (loadedPresetMutex);
+        for (auto inst : instruments)
+        {
+            for (int r = 0; r < inst->getNumResonatorModules(); ++r)
+            {
+                std::shared_ptr<ResonatorModule> res = inst->getResonatorPtr (r);
+                snapshotResonators.push_back (res);
+                snapshot.push_back (std::vector<std::vector<double>> (res->getNumStateVectors(), std::vector<double> (res->getStateVectorSize(), 0.0)));
+            }
+        }
+        stateSnapshotReady = false;
+        stateSnapshotTaken.reset();
+        stateSnapshotRequested = true;
+    }
+    
+    // the audio thread is never waited for longer than Global::stateSnapshotTimeout (e.g. when it is not running)
+    stateSnapshotTaken.wait (Global::stateSnapshotTimeout);
+    stateSnapshotRequested = false;
+    
+    // the audio thread might still be copying (the resonators are released here, not on the audio thread)
+    const std::lock_guard<std::mutex> lock (stateSnapshotMutex);
+    snapshotResonators.clear();
+    return stateSnapshotReady;
+}
+
+void ModularVSTAudioProcessor::takeStateSnapshot()
+{
+    TraceCapture::Scope traceScope ("takeStateSnapshot");
+    std::unique_lock<std::mutex> lock (stateSnapshotMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    
+    // the resonators were collected (and are kept alive) by requestStateSnapshot, a resonator that has been removed since is not ready and stops the copy
+    if (!stateSnapshotRequested)
+        return;
+    
+    auto& snapshot = stateSnapshots[1 - stateSnapshotReadIdx];
+    for (size_t idx = 0; idx < snapshotResonators.size(); ++idx)
+        if (!snapshotResonators[idx]->copyStatesTo (snapshot[idx]))
+            return;
+    
+    stateSnapshotReadIdx = 1 - stateSnapshotReadIdx;
+    stateSnapshotRequested = false;
+    stateSnapshotReady = true;
+    stateSnapshotTaken.signal(); // only when the states are saved by the host, so the lock inside is acceptable
 }
 
 //==============================================================================
@@ -508,22 +874,29 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 
 void ModularVSTAudioProcessor::addInstrument()
 {
-    std::shared_ptr<Instrument> newInstrument = std::make_shared<Instrument> (fs);
-    newInstrument->setName ("Instrument " + String(instruments.size()));
-    newInstrument->setExcitationType (curExcitationType);
-    currentlyActiveInstrument = newInstrument;
-    
+    std::shared_ptr<Instrument> newInstrument = createInstrument (static_cast<int> (instruments.size()));
     instruments.push_back (newInstrument);
+    setCurrentlyActiveInstrument (newInstrument);
 
     refreshEditor = true;
 }
 
+std::shared_ptr<Instrument> ModularVSTAudioProcessor::createInstrument (int idx)
+{
+    std::shared_ptr<Instrument> newInstrument = std::make_shared<Instrument> (fs, processingMode.load());
+    newInstrument->setName ("Instrument " + String (idx));
+    newInstrument->setExcitationType (curExcitationType);
+    newInstrument->setLoadMeter (&loadMeter);
+    newInstrument->setWorkerPool (&workerPool);
+    return newInstrument;
+}
+
 void ModularVSTAudioProcessor::addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo inOutInfo, bool advanced)
 {
     jassert(currentlyActiveInstrument != nullptr);
     
-    currentlyActiveInstrument->addResonatorModule (rmt, parameters, inOutInfo, advanced);
-    refreshEditor = true;
+    if (currentlyActiveInstrument->addResonatorModule (rmt, parameters, inOutInfo, advanced))
+        refreshEditor = true;
 }
 
 void ModularVSTAudioProcessor::setApplicationState (ApplicationState a)
@@ -534,6 +907,11 @@ void ModularVSTAudioProcessor::setApplicationState (ApplicationState a)
         case normalState:
             setStatesToZero (false);
             break;
+        case editDensityState:
+            // keep the instrument sounding while changing the density (see ResonatorModule::requestRegrid)
+            setStatesToZero (false);
+            highlightInstrument (currentlyActiveInstrument);
+            break;
         case removeResonatorModuleState:
         case editConnectionState:
             if (currentlyActiveInstrument != nullptr)
@@ -559,6 +937,21 @@ void ModularVSTAudioProcessor::highlightInstrument (std::shared_ptr<Instrument>
 
 PresetResult ModularVSTAudioProcessor::savePreset (String& filePath)
 {
+    // binary presets also store the grid sizes for the current sample rate
+    if (filePath.endsWith (Global::binaryPresetExtension))
+    {
+        PresetData presetData;
+        presetData.readFromInstruments (instruments, fs);
+        
+        File presetFile (filePath);
+        presetFile.deleteFile();
+        FileOutputStream stream (presetFile);
+        if (stream.failedToOpen())
+            return presetNotLoaded;
+        presetData.writeToBinary (stream);
+        return success;
+    }
+    
     std::ofstream file;
     const char* pathToUse = String (filePath).getCharPointer();
     file.open (pathToUse);
@@ -724,14 +1117,44 @@ PresetResult ModularVSTAudioProcessor::savePreset (String& filePath)
 
 PresetResult ModularVSTAudioProcessor::loadPreset (String& fileName, bool loadFromBinary)
 {
+    std::shared_ptr<const PresetData> presetData;
+    PresetResult res = parsePreset (presetData, fileName, loadFromBinary);
+    if (res != success)
+        return res;
+    
+    loadPresetFromPresetData (*presetData);
+
+    return success;
+}
+
+PresetResult ModularVSTAudioProcessor::parsePreset (std::shared_ptr<const PresetData>& presetData, String& fileName, bool loadFromBinary)
+{
+    // Embedded presets are parsed on first use and cached by the index
+    if (loadFromBinary)
+    {
+        PresetResult res = success;
+        presetData = presetIndex.getPreset (fileName, res);
+        return res;
+    }
+    
+    std::shared_ptr<PresetData> presetDataFromFile = std::make_shared<PresetData>();
+    presetData = presetDataFromFile;
+
+    // Binary preset files are read directly from memory
+    if (fileName.endsWith (Global::binaryPresetExtension))
+    {
+        File presetFile (fileName);
+        if (!presetFile.existsAsFile())
+            return fileNotFound;
+        MemoryMappedFile mappedFile (presetFile, MemoryMappedFile::readOnly);
+        return presetDataFromFile->readFromBinary (mappedFile.getData(), mappedFile.getSize()) ? success : presetNotLoaded;
+    }
     
     pugi::xml_document doc;
     std::string test = fileName.toStdString();// .getCharPointer()
     
     const char* pathToUse = test.c_str();
-    int sizeTest = 0;
-    const char* fileCharIfNeeded = fileName.getCharPointer();
-    pugi::xml_parse_result result = loadFromBinary ? doc.load_string(BinaryData::getNamedResource (fileCharIfNeeded, sizeTest)) : doc.load_file (pathToUse);
+    pugi::xml_parse_result result = doc.load_file (pathToUse);
 
     switch (result.status)
     {
@@ -744,16 +1167,167 @@ PresetResult ModularVSTAudioProcessor::loadPreset (String& fileName, bool loadFr
             return presetNotLoaded;
             break;
     }
-    
-    loadPresetFromPugiDoc (&doc);
+    return presetDataFromFile->readFromXML (&doc) ? success : presetNotLoaded;
+}
 
+#ifdef LOAD_ALL_UNITY_INSTRUMENTS
+PresetResult ModularVSTAudioProcessor::collectIncludedPresets (PresetData& presetData)
+{
+    /*  One instrument per included preset, read from the index rather than from one big concatenated xml string.
+        All included presets are still parsed and all instruments are still built at startup: presetSelect switches between the instruments vector directly, so an instrument cannot be built on its first selection yet. The index only removes the concatenated string.
+     */
+    for (int i = 0; i < Global::presetFilesToIncludeInUnity.size(); ++i)
+    {
+        PresetResult res = success;
+        std::shared_ptr<const PresetData> includedPreset = presetIndex.getPreset (Global::presetFilesToIncludeInUnity[i], res);
+        if (res != success)
+            return res;
+        presetData.append (*includedPreset);
+    }
     return success;
 }
+#endif
+
+void ModularVSTAudioProcessor::loadPresetAsync (String fileName, bool loadFromBinary)
+{
+    // only one preset is loaded at a time. The last requested preset is loaded after the current one has been swapped in.
+    if (presetLoadInProgress)
+    {
+        presetLoadQueued = true;
+        queuedPreset = fileName;
+        queuedPresetFromBinary = loadFromBinary;
+        return;
+    }
+    presetLoadInProgress = true;
+    
+    presetLoadPool.addJob ([this, fileName, loadFromBinary] () {
+        TraceCapture::Scope traceScope ("loadPreset");
+#ifdef LOAD_ALL_UNITY_INSTRUMENTS
+        ignoreUnused (fileName, loadFromBinary); // all instruments are loaded at once
+        std::shared_ptr<PresetData> allPresets = std::make_shared<PresetData>();
+        PresetResult res = collectIncludedPresets (*allPresets);
+        std::shared_ptr<const PresetData> presetData = allPresets;
+#else
+        std::shared_ptr<const PresetData> presetData;
+        String fileNameToLoad = fileName;
+        PresetResult res = parsePreset (presetData, fileNameToLoad, loadFromBinary);
+#endif
+        if (res != success)
+        {
+            debugLoadPresetResult (res);
+            presetLoadFailed = true;
+            sendChangeMessage();
+            return;
+        }
+        
+        // Build everything (states, coefficients, exciters, connections) here rather than on the message or audio thread
+        std::vector<std::shared_ptr<Instrument>> newInstruments;
+        newInstruments.reserve (8);
+        if (!buildInstrumentsFromPresetData (*presetData, newInstruments))
+        {
+            debugLoadPresetResult (presetNotLoaded);
+            presetLoadFailed = true;
+            sendChangeMessage();
+            return;
+        }
+        
+        const std::lock_guard<std::mutex> lock (loadedPresetMutex);
+        loadedInstruments.swap (newInstruments); // loadedInstruments is empty when no load is in progress
+        loadedPresetReady = true;
+    });
+}
+
+void ModularVSTAudioProcessor::swapInLoadedPreset()
+{
+    TraceCapture::Scope traceScope ("swapInLoadedPreset");
+    const std::lock_guard<std::mutex> lock (loadedPresetMutex);
+    if (!loadedPresetReady)
+        return;
+    loadedPresetReady = false;
+    
+    Instrument* previouslyActiveInstrument = currentlyActiveInstrument.get();
+    
+    // The old instruments are kept alive in loadedInstruments until the audio thread has crossfaded from them
+    instruments.swap (loadedInstruments);
+    std::shared_ptr<Instrument> newlyActiveInstrument = instruments.size() == 0 ? nullptr : instruments[instruments.size()-1];
+    
+    // nothing to crossfade (e.g., both presets are empty)
+    if (newlyActiveInstrument.get() == previouslyActiveInstrument)
+        presetSwapDone = true;
+    else
+        crossfadeOnSwitch = true;
+    
+    setCurrentlyActiveInstrument (newlyActiveInstrument);
+    refreshEditor = true;
+}
+
+void ModularVSTAudioProcessor::switchAudioInstrument (Instrument* inst)
+{
+    // the exciters need to be moved again for the new instrument
+    resetControlSmoothers();
+    
+    // crossfade from the instrument that was processed before the preset was swapped in
+    if (crossfadeOnSwitch.exchange (false))
+    {
+        crossfadeCounter = 0;
+        crossfadeLength = static_cast<int> (Global::presetCrossfadeTime * fs);
+        if (crossfadeLength > 0 && lastAudioInstrument != nullptr && lastAudioInstrument->areModulesReady())
+        {
+            fadingOutInstrument = lastAudioInstrument;
+        } else {
+            fadingOutInstrument = nullptr;
+            presetSwapDone = true;
+        }
+    }
+    lastAudioInstrument = inst;
+}
+
+void ModularVSTAudioProcessor::setCurrentlyActiveInstrument (std::shared_ptr<Instrument> i)
+{
+    // released after the mutex, i.e., once the audio thread is not using it anymore
+    std::shared_ptr<Instrument> previouslyActiveInstrument = currentlyActiveInstrument;
+    
+    // the audio thread only reads the pointer while holding the mutex
+    const std::lock_guard<std::mutex> lock (audioMutex);
+    currentlyActiveInstrument = i;
+    audioInstrumentIdx = getCurrentlyActiveInstrumentIdx();
+    audioInstrument = currentlyActiveInstrument.get();
+}
+
+void ModularVSTAudioProcessor::releaseSwappedOutInstruments()
+{
+    presetSwapDone = false;
+    {
+        const std::lock_guard<std::mutex> lock (loadedPresetMutex);
+        for (auto inst : loadedInstruments)
+            inst->removeAllResonators();
+        loadedInstruments.clear();
+    }
+    presetLoadInProgress = false;
+    
+    refreshEditor = true;
+    std::string debugString = String ("Preset loaded is: " + presetToLoad).toStdString();
+    Debug::Log (debugString);
+#ifndef EDITOR_AND_SLIDERS
+    refreshSliderValues();
+#else
+    refreshSlidersFromEditor = true;
+#endif
+}
 
 void ModularVSTAudioProcessor::loadPresetFromPugiDoc (pugi::xml_document* doc)
+{
+    PresetData presetData;
+    if (!presetData.readFromXML (doc))
+        DBG ("Preset could not be read completely");
+    loadPresetFromPresetData (presetData);
+}
+
+void ModularVSTAudioProcessor::loadPresetFromPresetData (const PresetData& presetData)
 {
     loadPresetMutex.lock();
-    // make sure that application is loaded from scratch
+    // make sure that application is loaded from scratch (the audio thread stops processing the old instruments first)
+    setCurrentlyActiveInstrument (nullptr);
     if (instruments.size() != 0)
     {
         for (auto inst : instruments)
@@ -763,349 +1337,92 @@ void ModularVSTAudioProcessor::loadPresetFromPugiDoc (pugi::xml_document* doc)
         while (instruments.size() > 0)
             instruments.erase(instruments.begin() + instruments.size() - 1);
     }
+    instruments.reserve (8);
     
-    pugi::xml_node node = doc->child("App");
-    pugi::xml_node instrum = node.child("Instrument");
-    
-    DBG("hello");
-    DBG(instrum.child("Resonator").child("PARAM").attribute("id").value());
-    DBG(doc->child("App").child("Instrument").child("Resonator").child("PARAM").attribute("value").value());
-    DBG(instrum.child("Connection").attribute("type").value());
+    if (!buildInstrumentsFromPresetData (presetData, instruments))
+        DBG ("Preset contains invalid grids or locations that are not on the grid");
     
-    std::vector<std::vector<std::vector<double>>> params;
-    std::vector<std::vector<std::vector<std::vector<double>>>> connects;
-    std::vector<std::vector<std::vector<std::vector<double>>>> outputLocs;
-    std::vector<std::vector<std::vector<double>>> outputChannels;
-    std::vector<std::vector<std::vector<int>>> resonatorInGroupIds;
+    if (instruments.size() != 0)
+        setCurrentlyActiveInstrument (instruments[instruments.size()-1]);
+    refreshEditor = true;
+    loadPresetMutex.unlock();
+}
 
-    std::vector<String> resoType;
-    std::vector<std::vector<String>> connType;
-//    std::vector<int> resoNum;
-//    std::vector<int> connNum;
-    
-    initActions.clear();
-    initModuleTypes.clear();
-    
+bool ModularVSTAudioProcessor::buildInstrumentsFromPresetData (const PresetData& presetData, std::vector<std::shared_ptr<Instrument>>& instrumentsToBuild)
+{
     InOutInfo IOinfo (false); // for presets we do not want to do a default initialisation of the in- and outputs
     
-    int i = 0;
-    
-    for (pugi::xml_node inst : node.children("Instrument"))
+    // locations stored as grid indices (older presets) can only be checked once the resonator is built
+    auto isOnGrid = [] (std::shared_ptr<ResonatorModule> res, const std::vector<double>& loc) -> bool {
+        return loc[0] <= 1 || loc[0] < res->getNumPoints();
+    };
+
+    for (auto& instrumentData : presetData.instruments)
     {
-        initActions.push_back(addInstrumentAction);
+        std::shared_ptr<Instrument> newInstrument = createInstrument (static_cast<int> (instrumentsToBuild.size()));
+        instrumentsToBuild.push_back (newInstrument);
         
-//        resoNum.push_back(0);
-//        connNum.push_back(0);
-        params.push_back(std::vector<std::vector<double>>());
-        connects.push_back(std::vector<std::vector<std::vector<double>>>());
-        outputLocs.push_back(std::vector<std::vector<std::vector<double>>>());
-        outputChannels.push_back(std::vector<std::vector<double>>());
-        
-        resonatorInGroupIds.push_back(std::vector<std::vector<int>>());
-
-        int r = 0;
-        int c = 0;
-        for (pugi::xml_node reso : inst.children("Resonator"))
+        for (auto& resonatorData : instrumentData.resonators)
         {
-            initActions.push_back (addResonatorModuleAction);
-
-            params[i].push_back(std::vector<double>());
-            outputLocs[i].push_back(std::vector<std::vector<double>>());
-            outputChannels[i].push_back(std::vector<double>());
-//            ++resoNum[i];
-            DBG("Resonator:");
-            for (pugi::xml_attribute resoAttr : reso.attributes())
-            {
-                DBG(resoAttr.name());
-                DBG(resoAttr.value());
-                auto attrib = String (resoAttr.name());
-                if (attrib == "type") {
-                    resoType.push_back(resoAttr.value());
-                }
-            }
-            DBG("Parameters:");
+            NamedValueSet parameters;
+            StringArray parameterNames = PresetData::getParameterNames (resonatorData.type);
+            for (int p = 0; p < parameterNames.size(); ++p)
+                parameters.set (parameterNames[p], resonatorData.parameters[p]);
             
-            for (pugi::xml_node resoChild : reso.children())
-            {
-                if (String (resoChild.name()) == "PARAM")
-                {
-                    DBG(resoChild.attribute("id").value());
-                    DBG(resoChild.attribute("value").value());
-                    params[i][r].push_back(std::stod(resoChild.attribute("value").value()));
-                }
-                else if (String (resoChild.name()) == "Output")
-                {
-                    DBG(resoChild.attribute("id").value());
-                    DBG(resoChild.attribute("loc").value());
-                    DBG(resoChild.attribute("channel").value());
-                    if (resoChild.attribute ("loc"))
-                        outputLocs[i][r].push_back (std::vector<double> {std::stod(resoChild.attribute("loc").value())});
-                    else
-                    {
-                        outputLocs[i][r].push_back(std::vector<double>{std::stod(resoChild.attribute("locX").value()),
-                            std::stod(resoChild.attribute("locY").value())
-                        });
-                    }
-                    outputChannels[i][r].push_back(std::stod(resoChild.attribute("channel").value()));
-                    
-                    initActions.push_back (addOutputAction);
-                    
-                }
-            }
-            ++r;
-        }
-        
-        // Do connections after resonators
-        // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-        for (pugi::xml_node conn : inst.children("Connection"))
-        {
-            initActions.push_back (addConnectionAction);
+            if (!newInstrument->addResonatorModule (resonatorData.type, parameters, IOinfo, true))
+                return false;
             
-            connects[i].push_back(std::vector<std::vector<double>>());
-            connType.push_back(std::vector<String>());
-//            ++connNum[i];
-            DBG("Connection:");
-            for (pugi::xml_attribute connAttr : conn.attributes())
+            std::shared_ptr<ResonatorModule> newResonator = newInstrument->getResonatorPtr (newInstrument->getNumResonatorModules() - 1);
+            for (auto& outputData : resonatorData.outputs)
             {
-                DBG(connAttr.name());
-                DBG(connAttr.value());
-                auto attrib = String(connAttr.name());
-                if (attrib == "type") {
-                    connType[i].push_back(connAttr.value());
-                }
-            }
-            DBG("Connection locations:");
-
-            for (pugi::xml_node connChild : conn.children())
-            {
-                DBG(connChild.attribute("id").value());
-                DBG(connChild.attribute("value").value());
-                if (connChild.attribute("value"))
-                    connects[i][c].push_back(std::vector<double> {std::stod(connChild.attribute("value").value())});
+                if (!isOnGrid (newResonator, outputData.loc))
+                    return false;
+                if (outputData.loc.size() == 1)
+                    newResonator->getInOutInfo()->addOutput (outputData.loc[0], outputData.channel);
                 else
-                    connects[i][c].push_back(std::vector<double> {std::stod(connChild.attribute("valueX").value()),
-                        std::stod(connChild.attribute("valueY").value())
-                    });
-
+                    newResonator->getInOutInfo()->addOutput (outputData.loc[0], outputData.loc[1], outputData.channel);
             }
-
-            ++c;
         }
         
-        int g = 0;
-        for (pugi::xml_node group : inst.children("ResonatorGroup"))
+        for (auto& connectionData : instrumentData.connections)
         {
-            initActions.push_back (addResonatorGroupAction);
-            resonatorInGroupIds[i].push_back (std::vector<int>());
-            for (pugi::xml_node resInGroup : group.children())
-            {
-                initActions.push_back (addResonatorToGroupAction);
-                resonatorInGroupIds[i][g].push_back (std::stoi(resInGroup.attribute("id").value()));
-            }
-            ++g;
+            if (!isOnGrid (newInstrument->getResonatorPtr (connectionData.resFromIdx), connectionData.locFrom)
+                || !isOnGrid (newInstrument->getResonatorPtr (connectionData.resToIdx), connectionData.locTo))
+                return false;
+            
+            if (connectionData.locFrom.size() == 1)
+                newInstrument->addFirstConnection (newInstrument->getResonatorPtr (connectionData.resFromIdx),
+                                                   connectionData.type,
+                                                   connectionData.locFrom[0]);
+            else
+                newInstrument->addFirstConnection (newInstrument->getResonatorPtr (connectionData.resFromIdx),
+                                                   connectionData.type,
+                                                   connectionData.locFrom[0], connectionData.locFrom[1]);
+            if (connectionData.locTo.size() == 1)
+                newInstrument->addSecondConnection (newInstrument->getResonatorPtr (connectionData.resToIdx),
+                                                    connectionData.locTo[0]);
+            else
+                newInstrument->addSecondConnection (newInstrument->getResonatorPtr (connectionData.resToIdx),
+                                                    connectionData.locTo[0], connectionData.locTo[1]);
+            newInstrument->setCurrentlyActiveConnection (nullptr);
+            newInstrument->setAction (noAction);
         }
-        ++i;
-        // --------------------------------------------------------------------------------------------------
-
         
-    }
-//    if (resoNum.size() != connNum.size())
-//    {
-//        DBG ("Silvin: If this happens, I apparently didn't understand it correctly :)");
-//    }
-//    for (int i = 0; i < resoNum.size(); ++i)
-//    {
-//    }
-    
-    for (int i = 0; i < resoType.size(); ++i) {
-        if (resoType[i] == "Stiff_String") { initModuleTypes.push_back(stiffString); }
-        else if (resoType[i] == "Bar") { initModuleTypes.push_back(bar); }
-        else if (resoType[i] == "Thin_Plate") { initModuleTypes.push_back(thinPlate); }
-        else if (resoType[i] == "Membrane") { initModuleTypes.push_back(membrane); }
-        else if (resoType[i] == "Stiff_Membrane") { initModuleTypes.push_back(stiffMembrane); }
-    }
-    
-    int numModules = 0;
-    for (int i = 0; i < initActions.size(); ++i)
-    {
-        if (initActions[i] == addResonatorModuleAction)
-            ++numModules;
-        
-    }
-    
-    if (numModules != initModuleTypes.size())
-        std::cout << "WRONG NUMBER OF MODULE TYPES ASSIGNED. CHANGE initModuleTypes VECTOR TO MATCH THE AMOUNT OF 'addResonatorModuleAction's IN initModuleTypes." << std::endl;
-    
-    
-    if (instruments.size() == 0)
-    {
-        instruments.reserve (8);
-    }
-    else
-    {
-        for (auto inst : instruments)
-            if (inst->getFs() != fs)
-                inst->initialise (fs);
-            
-    }
-    
-    // indices  for loop below
-    int m = 0;  // module type
-    int r;      // resonator
-    int c;      // connection
-    int g;      // group
-    int rIG;    // resonator in group
-    int o;      // output
-    i = -1; // reinitialise instrument index
-
-    NamedValueSet parameters;
-    for (int a = 0; a < initActions.size(); ++a)
-    {
-        switch (initActions[a]) {
-            case addInstrumentAction:
-            {
-                addInstrument();
-                ++i;
-                r = 0;
-                c = 0;
-                g = 0;
-                break;
-            }
-            case addResonatorModuleAction:
-            {
-                o = 0;
-                switch (initModuleTypes[m]) {
-                    case stiffString:
-                        parameters = {
-                            {"L", params[i][r][0]},
-                            {"T", params[i][r][1]},
-                            {"rho", params[i][r][2]},
-                            {"A", params[i][r][3]},
-                            {"E", params[i][r][4]},
-                            {"I", params[i][r][5]},
-                            {"sig0", params[i][r][6]},
-                            {"sig1", params[i][r][7]} };
-                        break;
-                    case bar:
-                        parameters = {
-                            {"L", params[i][r][0]},
-                            {"rho", params[i][r][1]},
-                            {"A", params[i][r][2]},
-                            {"E", params[i][r][3]},
-                            {"I", params[i][r][4]},
-                            {"sig0", params[i][r][5]},
-                            {"sig1", params[i][r][6]} };
-                        break;
-                    case membrane:
-                        parameters = {
-                            {"Lx", params[i][r][0]},
-                            {"Ly", params[i][r][1]},
-                            {"T", params[i][r][2]},
-                            {"rho", params[i][r][3]},
-                            {"H", params[i][r][4]},
-                            {"sig0", params[i][r][5]},
-                            {"sig1", params[i][r][6]},
-                            {"maxPoints", params[i][r][7]} };
-                        break;
-                    case thinPlate:
-                        parameters = {
-                            {"Lx", params[i][r][0]},
-                            {"Ly", params[i][r][1]},
-                            {"rho", params[i][r][2]},
-                            {"H", params[i][r][3]},
-                            {"E", params[i][r][4]},
-                            {"nu", params[i][r][5]},
-                            {"sig0", params[i][r][6]},
-                            {"sig1", params[i][r][7]},
-                            {"maxPoints", params[i][r][8]} };
-                        break;
-                    case stiffMembrane:
-                        
-                        parameters = {
-                            {"Lx", params[i][r][0]},
-                            {"Ly", params[i][r][1]},
-                            {"rho", params[i][r][2]},
-                            {"H", params[i][r][3]},
-                            {"T", params[i][r][4]},
-                            {"E", params[i][r][5]},
-                            {"nu", params[i][r][6]},
-                            {"sig0", params[i][r][7]},
-                            {"sig1", params[i][r][8]},
-                            {"maxPoints", params[i][r][9]} };
-                        break;
-                    default:
-                        break;
-                }
-                addResonatorModule (initModuleTypes[m], parameters, IOinfo);
-                ++m;
-                ++r;
-                break;
-            }
-            case addConnectionAction:
-            {
-                int resFromIdx = connects[i][c][0][0];
-                double resFromLoc1 = connects[i][c][1][0];
-                double resFromLoc2 = (connects[i][c][1].size() == 1) ? -1 : connects[i][c][1][1];
-                int resToIdx = connects[i][c][2][0];
-                double resToLoc1 = connects[i][c][3][0];
-                double resToLoc2 = (connects[i][c][3].size() == 1) ? -1 : connects[i][c][3][1];
-                ConnectionType curConnType;
-                
-                if (connType[i][c] == "rigid")
-                    curConnType = rigid;
-                else if (connType[i][c] == "linear")
-                    curConnType = linearSpring;
-                else if (connType[i][c] == "nonlinear")
-                    curConnType = nonlinearSpring;
-                        
-                if (resFromLoc2 == -1)
-                    instruments[i]->addFirstConnection (instruments[i]->getResonatorPtr (resFromIdx),
-                                                        curConnType,
-                                                        resFromLoc1);
-                else
-                    instruments[i]->addFirstConnection (instruments[i]->getResonatorPtr (resFromIdx),
-                                                        curConnType,
-                                                        resFromLoc1, resFromLoc2);
-                if (resToLoc2 == -1)
-                    instruments[i]->addSecondConnection (instruments[i]->getResonatorPtr (resToIdx),
-                                                         resToLoc1);
-                else
-                    instruments[i]->addSecondConnection (instruments[i]->getResonatorPtr (resToIdx),
-                                                         resToLoc1, resToLoc2);
-                instruments[i]->setCurrentlyActiveConnection (nullptr);
-                instruments[i]->setAction (noAction);
-                ++c;
-                break;
-            }
-            case addOutputAction:
+        for (int g = 0; g < instrumentData.resonatorGroups.size(); ++g)
+        {
+            newInstrument->addResonatorGroup();
+            // group numbers start at 1
+            for (auto id : instrumentData.resonatorGroups[g])
             {
-                // as the resonator idx is incremented before the outputs are added, subtract 1 from this index
-                if (outputLocs[i][r-1][o].size() == 1)
-                    instruments[i]->getResonatorPtr(r-1)->getInOutInfo()->addOutput (outputLocs[i][r-1][o][0], outputChannels[i][r-1][o]);
-                else
-                    instruments[i]->getResonatorPtr(r-1)->getInOutInfo()->addOutput (outputLocs[i][r-1][o][0], outputLocs[i][r-1][o][1], outputChannels[i][r-1][o]);
-
-                ++o;
-                break;
+                newInstrument->getCurrentlySelectedResonatorGroup()->addResonator (newInstrument->getResonatorPtr (id), g + 1);
+                DBG ("Resonator " + String (id) + " is part of group " + String (g + 1));
             }
-            case addResonatorGroupAction:
-                instruments[i]->addResonatorGroup();
-                ++g; // addResonatorToGroupAction starts at 1
-                rIG = 0;
-                break;
-            case addResonatorToGroupAction:
-                instruments[i]->getCurrentlySelectedResonatorGroup()->addResonator (instruments[i]->getResonatorPtr (resonatorInGroupIds[i][g-1][rIG]), g);
-                DBG ("Resonator " + String (resonatorInGroupIds[i][g-1][rIG]) + " is part of group " + String (g));
-
-                ++rIG;
-                break;
-
-            default:
-                break;
         }
+        newInstrument->refreshPartitions();
     }
-    currentlyActiveInstrument->setCurrentlySelectedResonatorToNullptr();
-    loadPresetMutex.unlock();
+    if (instrumentsToBuild.size() != 0)
+        instrumentsToBuild[instrumentsToBuild.size()-1]->setCurrentlySelectedResonatorToNullptr();
+    return true;
 }
 
 //# ifdef NO_EDITOR
@@ -1278,48 +1595,57 @@ void ModularVSTAudioProcessor::changeListenerCallback (ChangeBroadcaster* change
 {
     if (changeBroadcaster == this)
     {
-        if (shouldLoadFromBinary)
+        // a preset that was loaded in the background is ready to be swapped in
+        if (loadedPresetReady)
+            swapInLoadedPreset();
+        
+        // the audio thread is done crossfading from the old instruments
+        if (presetSwapDone)
+            releaseSwappedOutInstruments();
+        
+        if (presetLoadFailed)
         {
-#ifdef LOAD_ALL_UNITY_INSTRUMENTS
-            pugi::xml_document doc;
-            pugi::xml_parse_result result = doc.load_string (String(totPreset).getCharPointer());
-            loadPresetFromPugiDoc (&doc);
-            PresetResult res;
-            switch (result.status)
+            presetLoadFailed = false;
+            presetLoadInProgress = false;
+        }
+        
+        // restore a session that was set while a preset was loading
+        if (!presetLoadInProgress && sessionRestorePending)
+            restoreSessionState (true);
+        
+        // load the preset that was requested while the previous one was loading
+        if (!presetLoadInProgress && presetLoadQueued)
+        {
+            presetLoadQueued = false;
+            loadPresetAsync (queuedPreset, queuedPresetFromBinary);
+        }
+        
+        if (presetLoadRequested)
+        {
+            presetLoadRequested = false;
+            
+            // the instruments are not rebuilt from the session anymore (see prepareToPlay)
+            sessionPreset = nullptr;
+            
+            // presets from binary are loaded in the background while the current instrument keeps playing
+            if (shouldLoadFromBinary)
             {
-                case pugi::status_ok:
-                    res = success;
-                    break;
-                case pugi::status_file_not_found:
-                    res = fileNotFound;
-                    break;
-                default:
-                    res = presetNotLoaded;
-                    break;
-            }
-#else
-            PresetResult res = loadPreset (presetToLoad, shouldLoadFromBinary);
-#endif
-            debugLoadPresetResult (res);
-            if (res != success)
+                loadPresetAsync (presetToLoad, shouldLoadFromBinary);
+            } else {
                 for (auto inst : instruments)
-                    inst->reReadyAllModules();
-            else
-            {
-                currentlyActiveInstrument = instruments[instruments.size()-1];
+                    inst->unReadyAllModules();
                 refreshEditor = true;
-            }
-        } else {
-            loadPresetWindowCallback (presetToLoad);
-        }
-        std::string debugString = String("Preset loaded is: " + presetToLoad).toStdString();
-        Debug::Log (debugString);
+                loadPresetWindowCallback (presetToLoad);
+                
+                std::string debugString = String("Preset loaded is: " + presetToLoad).toStdString();
+                Debug::Log (debugString);
 #ifndef EDITOR_AND_SLIDERS
-        refreshSliderValues();
+                refreshSliderValues();
 #else
-        refreshSlidersFromEditor = true;
+                refreshSlidersFromEditor = true;
 #endif
-
+            }
+        }
     }
 #if defined(NO_EDITOR) || defined(EDITOR_AND_SLIDERS)
     for (int i = 0; i < presetSelectID; ++i)
@@ -1328,6 +1654,15 @@ void ModularVSTAudioProcessor::changeListenerCallback (ChangeBroadcaster* change
 
 }
 
+void ModularVSTAudioProcessor::timerCallback()
+{
+    for (auto inst : instruments)
+        inst->requestModulationRegrids();
+    
+    if (loadedPresetReady || presetSwapDone || presetLoadFailed || presetLoadRequested)
+        changeListenerCallback (this);
+}
+
 void ModularVSTAudioProcessor::setShouldLoadPreset (String filename, bool loadFromBinary, std::function<void(String)> callback)
 {
     shouldLoadPreset = true;
@@ -1353,7 +1688,7 @@ void ModularVSTAudioProcessor::changeActiveInstrument (std::shared_ptr<Instrumen
     setToZero = true;
     highlightInstrument (instToChangeTo);
 #endif
-    currentlyActiveInstrument = instToChangeTo;
+    setCurrentlyActiveInstrument (instToChangeTo);
 
 //    std::cout << currentlyActiveInstrument->getName() << " is active now." << std::endl;
 
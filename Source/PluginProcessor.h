@@ -10,6 +10,10 @@
 
 #include <JuceHeader.h>
 #include "Instrument.h"
+#include "ControlSmoother.h"
+#include "PresetData.h"
+#include "PresetIndex.h"
+#include "LoadGovernor.h"
 #include <fstream>
 #include <iostream>
 #include "DebugCPP.h"
@@ -31,7 +35,7 @@ extern "C"
 }
 
 
-class ModularVSTAudioProcessor  : public juce::AudioProcessor, public ChangeListener, public ChangeBroadcaster
+class ModularVSTAudioProcessor  : public juce::AudioProcessor, public ChangeListener, public ChangeBroadcaster, private Timer
 {
 public:
     //==============================================================================
@@ -72,6 +76,7 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     void addInstrument();
+    std::shared_ptr<Instrument> createInstrument (int idx); // does not add the instrument to the application
     void addResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, InOutInfo inOutInfo = InOutInfo(), bool advanced = true);
 
     void addChannelProcessor() {
@@ -102,7 +107,8 @@ public:
     void dontRefreshEditor() { refreshEditor = false; };
         
     std::shared_ptr<Instrument> getCurrentlyActiveInstrument() { return currentlyActiveInstrument; };
-    void setCurrentlyActiveInstrument (std::shared_ptr<Instrument> i) { currentlyActiveInstrument = i; };
+    // Message thread. Also publishes the instrument to the audio thread, which only processes the currently active instrument.
+    void setCurrentlyActiveInstrument (std::shared_ptr<Instrument> i);
 
     void setStatesToZero (bool s) { setToZero = s; };
     
@@ -117,7 +123,36 @@ public:
     // Presets
     PresetResult savePreset (String& fileName);
     PresetResult loadPreset (String& fileName, bool loadFromBinary);
+    PresetResult parsePreset (std::shared_ptr<const PresetData>& presetData, String& fileName, bool loadFromBinary); // reads both XML and binary presets
+#ifdef LOAD_ALL_UNITY_INSTRUMENTS
+    PresetResult collectIncludedPresets (PresetData& presetData); // all included presets, so every instrument is still built at startup (not on first selection)
+#endif
     void loadPresetFromPugiDoc (pugi::xml_document* doc);
+    void loadPresetFromPresetData (const PresetData& presetData);
+    bool buildInstrumentsFromPresetData (const PresetData& presetData, std::vector<std::shared_ptr<Instrument>>& instrumentsToBuild); // false if a resonator cannot be initialised or a location is not on the grid of its resonator
+    
+    /*  Asynchronous preset loading:
+            - loadPresetAsync (message thread) parses the preset and builds the instruments on a background thread,
+            - swapInLoadedPreset (message thread) swaps the new instruments in and publishes the new active instrument,
+            - switchAudioInstrument (audio thread, at the start of a block) picks up the published instrument and crossfades from the previous one,
+            - releaseSwappedOutInstruments (message thread) deletes the old instruments once the crossfade is done.
+        The instruments vector is only changed on the message thread, so the editor can use it (getInstrumentsRef) while the audio thread is running. Where it is replaced it is also guarded by loadedPresetMutex, because hosts can save the session (getStateInformation) from other threads.
+     */
+    void loadPresetAsync (String fileName, bool loadFromBinary);
+    void swapInLoadedPreset();
+    void switchAudioInstrument (Instrument* inst);
+    void releaseSwappedOutInstruments();
+    
+    /*  Session state (getStateInformation / setStateInformation): a binary preset of all instruments, the plugin parameters and (optionally) the states of the resonator modules.
+            - requestStateSnapshot (the thread the host saves the session on) asks the audio thread for a copy of the states and waits for it (at most Global::stateSnapshotTimeout),
+            - takeStateSnapshot (audio thread, at the end of a block) copies the states into the back buffer and swaps the buffers,
+            - restoreSessionState builds the instruments of a restored session and sets their states (the current instruments are kept if that fails). The session preset is kept, so prepareToPlay rebuilds it until another preset is loaded.
+     */
+    bool requestStateSnapshot();
+    void takeStateSnapshot();
+    bool readSessionState (const void* data, int sizeInBytes);
+    void restoreSessionState (bool swapInAtBlockStart);
+    
     String getPresetPath() {return presetPath; }
     void debugLoadPresetResult (PresetResult res);
     
@@ -139,8 +174,11 @@ public:
         activateSecondExciterID,
         presetSelectID,
 #ifndef LOAD_ALL_UNITY_INSTRUMENTS
-        loadPresetToggleID
+        loadPresetToggleID,
 #endif
+        tensionID,
+        densityID,
+        dampingID
     };
     
     void myRangedAudioParameterChanged (RangedAudioParameter* myAudioParameter);
@@ -155,6 +193,10 @@ public:
 #endif
     
     void changeListenerCallback (ChangeBroadcaster* changeBroadcaster) override;
+    
+    // Message thread. Handles the requests that the audio thread signals through flags (it does not send change messages).
+    void timerCallback() override;
+    
     void setShouldLoadPreset (String filename, bool loadFromBinary, std::function<void(String)> callback = {});
     
     void LoadIncludedPreset (int i);
@@ -162,27 +204,53 @@ public:
     void changeActiveInstrument (std::shared_ptr<Instrument> instToChangeTo);
     
     void refreshSliderValues();
+    
+    // Control-rate smoothing of the virtual mouse and bow parameters
+    void refreshControlSmoothers();
+    void resetControlSmoothers();
+    void stepControlSmoothers();
+    
+    // Timing of processBlock
+    DSPLoadMeter& getLoadMeter() { return loadMeter; };
+    LoadGovernor& getLoadGovernor() { return loadGovernor; };
+    // Chrome trace-event capture (see TraceCapture). Can be toggled at any time.
+    void startTraceCapture() { traceCapture->start(); };
+    bool stopTraceCapture (const File& file) { return traceCapture->stop (file); };
+    bool isCapturingTrace() { return traceCapture->isCapturing(); };
+    
+    int getCurrentlyActiveInstrumentIdx() {
+        for (int i = 0; i < instruments.size(); ++i)
+            if (instruments[i] == currentlyActiveInstrument)
+                return i;
+        return -1;
+    };
 private:
     //==============================================================================
-    int fs;
+    int fs = 0;
+    std::atomic<ProcessingMode> processingMode { realTimeMode }; // of this instance, set in prepareToPlay. Read when the instruments are built (also on the preset loading thread)
     int numOfBinaryPresets;
     std::vector<std::shared_ptr<Instrument>> instruments;
     bool refreshEditor = true;
     
     std::shared_ptr<Instrument> currentlyActiveInstrument = nullptr;
+    
+    // The instrument that the audio thread processes (see setCurrentlyActiveInstrument). Only changed while holding audioMutex.
+    std::atomic<Instrument*> audioInstrument { nullptr };
+    std::atomic<int> audioInstrumentIdx { -1 };
+    Instrument* lastAudioInstrument = nullptr; // only used on the audio thread
+    
     bool setToZero = false;
     
     ApplicationState applicationState = normalState;
     
     ExcitationType curExcitationType = noExcitation;
     
-    std::vector<Action> initActions;
-    std::vector<ResonatorModuleType> initModuleTypes;
-    
 #if JUCE_MAC
     String presetPath = "../../../../Presets/";
 #elif JUCE_WINDOWS
     String presetPath = "../../Presets/";
+#else
+    String presetPath = "Presets/";
 #endif
     
     long counter = 0;
@@ -207,11 +275,17 @@ private:
     AudioParameterBool* loadPresetToggle;
 #endif
     
+    // Modulation of the resonator modules (multipliers)
+    AudioParameterFloat* tension;
+    AudioParameterFloat* density;
+    AudioParameterFloat* damping;
+    
     std::vector<RangedAudioParameter*> allParameters;
     std::vector<float> sliderValues;
-    std::vector<float> mouseSmoothValues1;
-    std::vector<float> mouseSmoothValues2;
-    float velocitySmoothValue;
+    std::vector<ControlSmoother> mouseSmoothers1;
+    std::vector<ControlSmoother> mouseSmoothers2;
+    ControlSmoother velocitySmoother;
+    int controlCounter = 0;
     std::vector<float> prevSliderValues;
 
 //#endif
@@ -230,9 +304,39 @@ private:
     
     bool sliderControl = false;
     
-#ifdef LOAD_ALL_UNITY_INSTRUMENTS
-    std::string totPreset;
-#endif
+    PresetIndex presetIndex; // presets embedded in BinaryData
+    
+    // Asynchronous preset loading
+    std::mutex loadedPresetMutex; // guards loadedInstruments and replacing instruments (between the loading thread, the message thread and the session saving thread)
+    std::vector<std::shared_ptr<Instrument>> loadedInstruments; // new instruments before the swap, old instruments after
+    std::atomic<bool> loadedPresetReady { false };
+    std::atomic<bool> presetSwapDone { false };
+    std::atomic<bool> presetLoadFailed { false };
+    std::atomic<bool> presetLoadRequested { false };
+    std::atomic<bool> crossfadeOnSwitch { false }; // the next instrument published to the audio thread is a swapped in preset
+    
+    bool presetLoadInProgress = false;
+    bool presetLoadQueued = false;
+    String queuedPreset = "";
+    bool queuedPresetFromBinary = false;
+    
+    Instrument* fadingOutInstrument = nullptr; // kept alive by loadedInstruments
+    int crossfadeCounter = 0;
+    int crossfadeLength = 0;
+    
+    // Session state
+    static const int sessionMagic = 0x5353564d; // "MVSS"
+    static const int sessionVersion = 1;
+    std::mutex stateSnapshotMutex; // only tried to lock on the audio thread
+    std::vector<std::vector<std::vector<double>>> stateSnapshots[2]; // per resonator module (of all instruments), per state vector
+    std::vector<std::shared_ptr<ResonatorModule>> snapshotResonators; // collected by requestStateSnapshot so that the audio thread does not use the instruments vector
+    int stateSnapshotReadIdx = 0; // the other snapshot is written to by the audio thread
+    std::atomic<bool> stateSnapshotRequested { false };
+    std::atomic<bool> stateSnapshotReady { false };
+    WaitableEvent stateSnapshotTaken;
+    std::shared_ptr<PresetData> sessionPreset; // preset of the restored session (until another preset is loaded)
+    std::vector<std::vector<std::vector<double>>> sessionStates; // only restored once
+    bool sessionRestorePending = false; // the session was set while a preset was loading
 
 	// Prevent errors regarding ParameterID (and versionHints) in JUCE versions 7.0.0 and above
 #if (JUCE_VERSION < 0x070000)
@@ -246,6 +350,19 @@ private:
 		return ParameterID (param, 1);
 	}
 #endif
+    DSPLoadMeter loadMeter;
+    LoadGovernor loadGovernor { *this };
+    
+    // Processes the independent partitions of an instrument in parallel (see Instrument::processPartitions)
+    WorkerPool workerPool { jmax (0, jmin (Global::maxWorkerThreads, SystemStats::getNumCpus() - 1)) };
+    
+    // Drains the log records posted from the audio thread
+    SharedResourcePointer<RTLog> rtLog;
+    SharedResourcePointer<TraceCapture> traceCapture;
+    
+    // Keep this at the end so that it gets destroyed (and its jobs finished) first
+    ThreadPool presetLoadPool { 1 };
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModularVSTAudioProcessor)
     
 };
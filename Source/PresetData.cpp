@@ -0,0 +1,554 @@
+/*
+  ==============================================================================
+
+    PresetData.cpp
+    Created: 19 Oct 2026 2:12:40pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "PresetData.h"
+#include "Instrument.h"
+
+bool PresetData::readFromXML (pugi::xml_document* doc)
+{
+    instruments.clear();
+    fs = 0;
+
+    pugi::xml_node node = doc->child ("App");
+    if (!node)
+        return false;
+
+    for (pugi::xml_node inst : node.children ("Instrument"))
+    {
+        InstrumentData instrumentData;
+        for (pugi::xml_node reso : inst.children ("Resonator"))
+        {
+            ResonatorData resonatorData;
+            resonatorData.type = getTypeFromString (reso.attribute ("type").value());
+            if (resonatorData.type == noResonatorModule)
+                return false;
+
+            for (pugi::xml_node resoChild : reso.children())
+            {
+                if (String (resoChild.name()) == "PARAM")
+                {
+                    resonatorData.parameters.push_back (std::stod (resoChild.attribute ("value").value()));
+                }
+                else if (String (resoChild.name()) == "Output")
+                {
+                    OutputData outputData;
+                    if (resoChild.attribute ("loc"))
+                        outputData.loc = { std::stod (resoChild.attribute ("loc").value()) };
+                    else
+                        outputData.loc = { std::stod (resoChild.attribute ("locX").value()),
+                                           std::stod (resoChild.attribute ("locY").value()) };
+                    outputData.channel = std::stoi (resoChild.attribute ("channel").value());
+                    resonatorData.outputs.push_back (outputData);
+                }
+            }
+
+            if (static_cast<int> (resonatorData.parameters.size()) != getNumParameters (resonatorData.type))
+                return false;
+
+            instrumentData.resonators.push_back (resonatorData);
+        }
+
+        for (pugi::xml_node conn : inst.children ("Connection"))
+        {
+            // the connection locations are stored in the order: resonator from, location from, resonator to, location to
+            std::vector<std::vector<double>> values;
+            for (pugi::xml_node connChild : conn.children())
+            {
+                if (connChild.attribute ("value"))
+                    values.push_back ({ std::stod (connChild.attribute ("value").value()) });
+                else
+                    values.push_back ({ std::stod (connChild.attribute ("valueX").value()),
+                                        std::stod (connChild.attribute ("valueY").value()) });
+            }
+            if (values.size() != 4)
+                return false;
+
+            ConnectionData connectionData;
+            String typeString (conn.attribute ("type").value());
+            if (typeString == "rigid")
+                connectionData.type = rigid;
+            else if (typeString == "linear")
+                connectionData.type = linearSpring;
+            else if (typeString == "nonlinear")
+                connectionData.type = nonlinearSpring;
+            else
+                return false;
+
+            connectionData.resFromIdx = values[0][0];
+            connectionData.locFrom = values[1];
+            connectionData.resToIdx = values[2][0];
+            connectionData.locTo = values[3];
+            instrumentData.connections.push_back (connectionData);
+        }
+
+        for (pugi::xml_node group : inst.children ("ResonatorGroup"))
+        {
+            std::vector<int> resonatorIds;
+            for (pugi::xml_node resInGroup : group.children())
+                resonatorIds.push_back (std::stoi (resInGroup.attribute ("id").value()));
+            instrumentData.resonatorGroups.push_back (resonatorIds);
+        }
+
+        instruments.push_back (instrumentData);
+    }
+    return isValid();
+}
+
+void PresetData::append (const PresetData& other)
+{
+    // the sample rate is only kept if both were saved at the same sample rate
+    if (instruments.size() == 0)
+        fs = other.fs;
+    else if (fs != other.fs)
+        fs = 0;
+    
+    instruments.insert (instruments.end(), other.instruments.begin(), other.instruments.end());
+}
+
+bool PresetData::isBinaryPreset (const void* data, size_t size)
+{
+    if (data == nullptr || size < sizeof (int))
+        return false;
+
+    return ByteOrder::littleEndianInt (data) == static_cast<uint32> (magic);
+}
+
+bool PresetData::readFromBinary (const void* data, size_t size)
+{
+    instruments.clear();
+    fs = 0;
+
+    if (!isBinaryPreset (data, size))
+        return false;
+
+    // reads directly from the given memory (no copy)
+    MemoryInputStream stream (data, size, false);
+
+    stream.readInt(); // magic
+    int fileVersion = stream.readInt();
+    if (fileVersion > version)
+    {
+        DBG ("Preset was saved with a newer version of the binary preset format");
+        return false;
+    }
+    fs = stream.readDouble();
+
+    // Returns false if a count can not possibly fit in the rest of the data (corrupt file)
+    auto readCount = [&stream] (int& count) -> bool {
+        count = stream.readInt();
+        return count >= 0 && count <= stream.getNumBytesRemaining();
+    };
+
+    auto readValues = [&stream, &readCount] (std::vector<double>& values) -> bool {
+        int numValues;
+        if (!readCount (numValues))
+            return false;
+        values.resize (numValues);
+        for (int i = 0; i < numValues; ++i)
+            values[i] = stream.readDouble();
+        return true;
+    };
+
+    int numInstruments;
+    if (!readCount (numInstruments))
+        return false;
+    instruments.resize (numInstruments);
+
+    for (auto& instrumentData : instruments)
+    {
+        int numResonators;
+        if (!readCount (numResonators))
+            return false;
+        instrumentData.resonators.resize (numResonators);
+        for (auto& resonatorData : instrumentData.resonators)
+        {
+            int type = stream.readInt();
+            if (type < stiffString || type > stiffMembrane)
+                return false;
+            resonatorData.type = static_cast<ResonatorModuleType> (type);
+            if (!readValues (resonatorData.parameters) || static_cast<int> (resonatorData.parameters.size()) != getNumParameters (resonatorData.type))
+                return false;
+
+            // version 1 stored the grid sizes, which are recalculated from the parameters anyway
+            if (fileVersion == 1)
+                stream.skipNextBytes (3 * sizeof (int));
+
+            int numOutputs;
+            if (!readCount (numOutputs))
+                return false;
+            resonatorData.outputs.resize (numOutputs);
+            for (auto& outputData : resonatorData.outputs)
+            {
+                outputData.channel = stream.readInt();
+                if (!readValues (outputData.loc))
+                    return false;
+            }
+        }
+
+        int numConnections;
+        if (!readCount (numConnections))
+            return false;
+        instrumentData.connections.resize (numConnections);
+        for (auto& connectionData : instrumentData.connections)
+        {
+            int type = stream.readInt();
+            if (type < rigid || type > nonlinearSpring)
+                return false;
+            connectionData.type = static_cast<ConnectionType> (type);
+            connectionData.resFromIdx = stream.readInt();
+            if (!readValues (connectionData.locFrom))
+                return false;
+            connectionData.resToIdx = stream.readInt();
+            if (!readValues (connectionData.locTo))
+                return false;
+        }
+
+        int numGroups;
+        if (!readCount (numGroups))
+            return false;
+        instrumentData.resonatorGroups.resize (numGroups);
+        for (auto& group : instrumentData.resonatorGroups)
+        {
+            int numResonatorsInGroup;
+            if (!readCount (numResonatorsInGroup))
+                return false;
+            group.resize (numResonatorsInGroup);
+            for (auto& id : group)
+                id = stream.readInt();
+        }
+    }
+    return isValid();
+}
+
+bool PresetData::isValid() const
+{
+    /*  A location is either a ratio (1D) or x and y ratios (2D) of the resonator it is on, or a grid index (older presets, larger than 1).
+        Grid indices can only be checked once the resonator has been built (see ModularVSTAudioProcessor::buildInstrumentsFromPresetData).
+     */
+    auto isValidLoc = [] (const std::vector<double>& loc, ResonatorModuleType type) -> bool {
+        bool is1D = type == stiffString || type == bar;
+        if (loc.size() == 1 && loc[0] > 1.0)
+            return loc[0] == floor (loc[0]) && std::isfinite (loc[0]);
+        
+        if (loc.size() != (is1D ? 1 : 2))
+            return false;
+        for (auto val : loc)
+            if (!(val >= 0.0 && val <= 1.0))
+                return false;
+        return true;
+    };
+    
+    for (auto& instrumentData : instruments)
+    {
+        int numResonators = static_cast<int> (instrumentData.resonators.size());
+        for (auto& resonatorData : instrumentData.resonators)
+            for (auto& outputData : resonatorData.outputs)
+                if (!isValidLoc (outputData.loc, resonatorData.type))
+                    return false;
+        
+        for (auto& connectionData : instrumentData.connections)
+        {
+            if (connectionData.resFromIdx < 0 || connectionData.resFromIdx >= numResonators
+                || connectionData.resToIdx < 0 || connectionData.resToIdx >= numResonators)
+                return false;
+            if (!isValidLoc (connectionData.locFrom, instrumentData.resonators[connectionData.resFromIdx].type)
+                || !isValidLoc (connectionData.locTo, instrumentData.resonators[connectionData.resToIdx].type))
+                return false;
+        }
+        
+        for (auto& group : instrumentData.resonatorGroups)
+            for (auto id : group)
+                if (id < 0 || id >= numResonators)
+                    return false;
+    }
+    return true;
+}
+
+void PresetData::readFromInstruments (std::vector<std::shared_ptr<Instrument>>& instrumentsToRead, double fsToSet)
+{
+    instruments.clear();
+    fs = fsToSet;
+
+    // Locations are stored as ratios, calculated in the same way as in ModularVSTAudioProcessor::savePreset
+    auto getLocRatio = [] (ResonatorModule* res, int loc) -> std::vector<double> {
+        if (res->isModule1D())
+            return { double (loc) / (res->getNumIntervals() + 1) };
+
+        int Nx = res->getNumIntervalsX();
+        int Ny = res->getNumIntervalsY();
+        return { double (loc % Nx) / (Nx + 1), double (loc / Nx) / (Ny + 1) };
+    };
+
+    for (auto inst : instrumentsToRead)
+    {
+        InstrumentData instrumentData;
+        for (int r = 0; r < inst->getNumResonatorModules(); ++r)
+        {
+            ResonatorModule* curResonator = inst->getResonatorPtr (r).get();
+            ResonatorData resonatorData;
+            resonatorData.type = curResonator->getResonatorModuleType();
+            
+            // the order of the parameters in the module does not necessarily match the order that they are loaded in
+            for (auto& name : getParameterNames (resonatorData.type))
+            {
+                var* value = curResonator->getParameters().getVarPointer (name);
+                resonatorData.parameters.push_back (value == nullptr ? 0.0 : static_cast<double> (*value));
+            }
+
+            for (int o = 0; o < curResonator->getInOutInfo()->getNumOutputs(); ++o)
+            {
+                OutputData outputData;
+                outputData.loc = getLocRatio (curResonator, curResonator->getInOutInfo()->getOutLocAt (o));
+                outputData.channel = curResonator->getInOutInfo()->getOutChannelAt (o);
+                resonatorData.outputs.push_back (outputData);
+            }
+            instrumentData.resonators.push_back (resonatorData);
+        }
+
+        for (auto& C : *inst->getConnectionInfo())
+        {
+            ConnectionData connectionData;
+            connectionData.type = C.connType;
+            connectionData.resFromIdx = C.res1->getID();
+            connectionData.locFrom = getLocRatio (C.res1.get(), C.loc1);
+            connectionData.resToIdx = C.res2->getID();
+            connectionData.locTo = getLocRatio (C.res2.get(), C.loc2);
+            instrumentData.connections.push_back (connectionData);
+        }
+
+        for (auto group : inst->getResonatorGroups())
+        {
+            std::vector<int> resonatorIds;
+            for (auto res : group->getResonatorsInGroup())
+                resonatorIds.push_back (res->getID());
+            instrumentData.resonatorGroups.push_back (resonatorIds);
+        }
+
+        instruments.push_back (instrumentData);
+    }
+}
+
+void PresetData::writeToXML (std::ostream& file)
+{
+    auto writeLoc = [&file] (const String& idString, const String& attribute, std::vector<double>& loc) {
+        file << "\t " << "\t " << "\t " << "<PARAM id=\"" << idString << "\" ";
+        if (loc.size() == 1)
+            file << attribute << "=\"" << loc[0] << "\"/>\n";
+        else
+            file << attribute << "X=\"" << loc[0] << "\" " << attribute << "Y=\"" << loc[1] << "\"/>\n";
+    };
+
+    file << "<App" << ">" << "\n";
+    for (int i = 0; i < instruments.size(); ++i)
+    {
+        file << "\t " << "<Instrument id=\"i" << i << "\">" << "\n";
+
+        for (int r = 0; r < instruments[i].resonators.size(); ++r)
+        {
+            ResonatorData& resonatorData = instruments[i].resonators[r];
+            file << "\t " << "\t " << "<Resonator id=\"i" << i << "_r" << r << "\" type=\"" << getTypeString (resonatorData.type) << "\">" << "\n";
+
+            // The parameter names are only written for readability. They are not used when loading the preset.
+            StringArray parameterNames = getParameterNames (resonatorData.type);
+            for (int p = 0; p < resonatorData.parameters.size(); ++p)
+                file << "\t " << "\t " << "\t " << "<PARAM id=\"i" << i << "_r" << r << "_" << parameterNames[p] << "\" value=\"" << resonatorData.parameters[p] << "\"/>\n";
+
+            for (int o = 0; o < resonatorData.outputs.size(); ++o)
+            {
+                OutputData& outputData = resonatorData.outputs[o];
+                file << "\t " << "\t " << "\t " << "<Output id=\"i" << i << "_r" << r << "_o" << o << "\" channel=\"" << outputData.channel;
+                if (outputData.loc.size() == 1)
+                    file << "\" loc=\"" << outputData.loc[0] << "\"/>\n";
+                else
+                    file << "\" locX=\"" << outputData.loc[0] << "\" locY=\"" << outputData.loc[1] << "\"/>\n";
+            }
+            file << "\t " << "\t " << "</Resonator>" << "\n";
+        }
+
+        for (int c = 0; c < instruments[i].connections.size(); ++c)
+        {
+            ConnectionData& connectionData = instruments[i].connections[c];
+            String idString = "i" + String (i) + "_c" + String (c);
+            file << "\t " << "\t " << "<Connection id=\"" << idString << "\" type=\"";
+            switch (connectionData.type)
+            {
+                case rigid:
+                    file << "rigid\">";
+                    break;
+                case linearSpring:
+                    file << "linear\">";
+                    break;
+                case nonlinearSpring:
+                    file << "nonlinear\">";
+                    break;
+                default:
+                    break;
+            }
+            file << "\n";
+
+            std::vector<double> resFrom { static_cast<double> (connectionData.resFromIdx) };
+            std::vector<double> resTo { static_cast<double> (connectionData.resToIdx) };
+            writeLoc (idString + "_fR", "value", resFrom);
+            writeLoc (idString + "_fL", "value", connectionData.locFrom);
+            writeLoc (idString + "_tR", "value", resTo);
+            writeLoc (idString + "_tL", "value", connectionData.locTo);
+
+            file << "\t " << "\t " << "</Connection>" << "\n";
+        }
+
+        for (int g = 0; g < instruments[i].resonatorGroups.size(); ++g)
+        {
+            file << "\t " << "\t " << "<ResonatorGroup id=\"i" << i << "_g" << g << "\">\n";
+            for (auto id : instruments[i].resonatorGroups[g])
+                file << "\t " << "\t " << "\t " << "<Res id=\"" << id << "\"/>\n";
+            file << "\t " << "\t " << "</ResonatorGroup>\n";
+        }
+
+        file << "\t " << "</Instrument>" << "\n";
+    }
+    file << "</App" << ">" << "\n";
+}
+
+void PresetData::writeToBinary (OutputStream& stream)
+{
+    auto writeValues = [&stream] (std::vector<double>& values) {
+        stream.writeInt (static_cast<int> (values.size()));
+        for (auto value : values)
+            stream.writeDouble (value);
+    };
+
+    stream.writeInt (magic);
+    stream.writeInt (version);
+    stream.writeDouble (fs);
+
+    stream.writeInt (static_cast<int> (instruments.size()));
+    for (auto& instrumentData : instruments)
+    {
+        stream.writeInt (static_cast<int> (instrumentData.resonators.size()));
+        for (auto& resonatorData : instrumentData.resonators)
+        {
+            stream.writeInt (resonatorData.type);
+            writeValues (resonatorData.parameters);
+
+            stream.writeInt (static_cast<int> (resonatorData.outputs.size()));
+            for (auto& outputData : resonatorData.outputs)
+            {
+                stream.writeInt (outputData.channel);
+                writeValues (outputData.loc);
+            }
+        }
+
+        stream.writeInt (static_cast<int> (instrumentData.connections.size()));
+        for (auto& connectionData : instrumentData.connections)
+        {
+            stream.writeInt (connectionData.type);
+            stream.writeInt (connectionData.resFromIdx);
+            writeValues (connectionData.locFrom);
+            stream.writeInt (connectionData.resToIdx);
+            writeValues (connectionData.locTo);
+        }
+
+        stream.writeInt (static_cast<int> (instrumentData.resonatorGroups.size()));
+        for (auto& group : instrumentData.resonatorGroups)
+        {
+            stream.writeInt (static_cast<int> (group.size()));
+            for (auto id : group)
+                stream.writeInt (id);
+        }
+    }
+    stream.flush();
+}
+
+PresetResult PresetData::convertFile (const File& fileFrom, const File& fileTo)
+{
+    if (!fileFrom.existsAsFile())
+        return fileNotFound;
+
+    PresetData presetData;
+    if (fileFrom.hasFileExtension (Global::binaryPresetExtension))
+    {
+        MemoryMappedFile mappedFile (fileFrom, MemoryMappedFile::readOnly);
+        if (!presetData.readFromBinary (mappedFile.getData(), mappedFile.getSize()))
+            return presetNotLoaded;
+    } else {
+        pugi::xml_document doc;
+        if (doc.load_file (fileFrom.getFullPathName().toRawUTF8()).status != pugi::status_ok
+            || !presetData.readFromXML (&doc))
+            return presetNotLoaded;
+    }
+
+    if (fileTo.hasFileExtension (Global::binaryPresetExtension))
+    {
+        fileTo.deleteFile();
+        FileOutputStream stream (fileTo);
+        if (stream.failedToOpen())
+            return presetNotLoaded;
+        presetData.writeToBinary (stream);
+    } else {
+        std::ofstream file (fileTo.getFullPathName().toStdString());
+        if (!file.is_open())
+            return presetNotLoaded;
+        presetData.writeToXML (file);
+    }
+    return success;
+}
+
+StringArray PresetData::getParameterNames (ResonatorModuleType rmt)
+{
+    switch (rmt)
+    {
+        case stiffString:
+            return { "L", "T", "rho", "A", "E", "I", "sig0", "sig1" };
+        case bar:
+            return { "L", "rho", "A", "E", "I", "sig0", "sig1" };
+        case membrane:
+            return { "Lx", "Ly", "T", "rho", "H", "sig0", "sig1", "maxPoints" };
+        case thinPlate:
+            return { "Lx", "Ly", "rho", "H", "E", "nu", "sig0", "sig1", "maxPoints" };
+        case stiffMembrane:
+            return { "Lx", "Ly", "rho", "H", "T", "E", "nu", "sig0", "sig1", "maxPoints" };
+        default:
+            return {};
+    }
+}
+
+String PresetData::getTypeString (ResonatorModuleType rmt)
+{
+    switch (rmt)
+    {
+        case stiffString:
+            return "Stiff_String";
+        case bar:
+            return "Bar";
+        case membrane:
+            return "Membrane";
+        case thinPlate:
+            return "Thin_Plate";
+        case stiffMembrane:
+            return "Stiff_Membrane";
+        default:
+            return "";
+    }
+}
+
+ResonatorModuleType PresetData::getTypeFromString (const String& typeString)
+{
+    if (typeString == "Stiff_String")
+        return stiffString;
+    else if (typeString == "Bar")
+        return bar;
+    else if (typeString == "Thin_Plate")
+        return thinPlate;
+    else if (typeString == "Membrane")
+        return membrane;
+    else if (typeString == "Stiff_Membrane")
+        return stiffMembrane;
+    return noResonatorModule;
+}
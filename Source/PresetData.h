@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    PresetData.h
+    Created: 19 Oct 2026 2:12:40pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+#include "pugixml.hpp"
+
+class Instrument;
+
+/*  Everything that is needed to build the instruments of a preset, independent of the file format. Presets can be stored as XML (as before) or in a versioned binary format that can be read straight from memory (BinaryData or a memory-mapped file) without parsing any text.
+
+    Binary format (little endian):
+        - header: magic ("MVSP"), version, sample rate that the preset was saved at (0 if not included), number of instruments
+        - per instrument: resonators, connections and resonator groups
+        - per resonator: type, parameter values (in the same order as in the XML presets) and outputs
+    Version 1 also stored the grid size (N, Nx, Ny) of each resonator. It is skipped when reading, as the grid is always recalculated from the parameters.
+    Both readers reject presets with unknown types or out-of-range resonator indices or locations.
+ */
+class PresetData
+{
+public:
+    PresetData() {};
+    ~PresetData() {};
+
+    struct OutputData
+    {
+        std::vector<double> loc; // ratio (1D) or x and y ratios (2D)
+        int channel;
+    };
+
+    struct ResonatorData
+    {
+        ResonatorModuleType type;
+        std::vector<double> parameters;
+        std::vector<OutputData> outputs;
+    };
+
+    struct ConnectionData
+    {
+        ConnectionType type;
+        int resFromIdx;
+        std::vector<double> locFrom; // ratio (1D) or x and y ratios (2D)
+        int resToIdx;
+        std::vector<double> locTo;
+    };
+
+    struct InstrumentData
+    {
+        std::vector<ResonatorData> resonators;
+        std::vector<ConnectionData> connections;
+        std::vector<std::vector<int>> resonatorGroups; // resonator indices per group
+    };
+
+    // Reading
+    bool readFromXML (pugi::xml_document* doc);
+    bool readFromBinary (const void* data, size_t size);
+    static bool isBinaryPreset (const void* data, size_t size);
+
+    // Adds the instruments of another preset (used to load all included presets at once)
+    void append (const PresetData& other);
+
+    // Reads the current state of the application
+    void readFromInstruments (std::vector<std::shared_ptr<Instrument>>& instruments, double fsToSet);
+
+    // Writing
+    void writeToXML (std::ostream& stream);
+    void writeToBinary (OutputStream& stream);
+
+    // Converts between the XML and binary formats. The format of the output file is determined by its extension (Global::binaryPresetExtension for binary).
+    static PresetResult convertFile (const File& fileFrom, const File& fileTo);
+
+    // Names of the parameters of each resonator module type, in the order that they are stored in
+    static StringArray getParameterNames (ResonatorModuleType rmt);
+    static int getNumParameters (ResonatorModuleType rmt) { return getParameterNames (rmt).size(); };
+    static String getTypeString (ResonatorModuleType rmt);
+    static ResonatorModuleType getTypeFromString (const String& typeString);
+
+    std::vector<InstrumentData> instruments;
+    double fs = 0; // sample rate that the preset was saved at (0 if not included). States of a session can only be restored at the same sample rate.
+
+private:
+    // Checks the resonator indices and locations of all instruments
+    bool isValid() const;
+    
+    static const int magic = 0x5053564d; // "MVSP"
+    static const int version = 2;
+
+    JUCE_LEAK_DETECTOR (PresetData)
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    PresetIndex.cpp
+    Created: 19 Oct 2026 3:41:07pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "PresetIndex.h"
+
+PresetIndex::PresetIndex (int cacheSizeToSet) : cacheSize (jmax (1, cacheSizeToSet))
+{
+    // only store where the presets are, nothing is parsed here
+    for (int i = 0; i < BinaryData::namedResourceListSize; ++i)
+    {
+        int size = 0;
+        const char* data = BinaryData::getNamedResource (BinaryData::namedResourceList[i], size);
+        if (data != nullptr)
+            index[BinaryData::namedResourceList[i]] = { data, size };
+    }
+}
+
+std::shared_ptr<const PresetData> PresetIndex::getPreset (const String& name, PresetResult& res)
+{
+    auto entry = index.find (name);
+    if (entry == index.end())
+    {
+        res = fileNotFound;
+        return nullptr;
+    }
+    
+    const std::lock_guard<std::mutex> lock (cacheMutex);
+    for (auto it = cache.begin(); it != cache.end(); ++it)
+    {
+        if (it->first == name)
+        {
+            // move to the front
+            cache.splice (cache.begin(), cache, it);
+            res = success;
+            return cache.front().second;
+        }
+    }
+    
+    // parse on first use
+    std::shared_ptr<PresetData> presetData = std::make_shared<PresetData>();
+    const char* data = entry->second.data;
+    int size = entry->second.size;
+    bool loaded = false;
+    if (PresetData::isBinaryPreset (data, size))
+    {
+        loaded = presetData->readFromBinary (data, size);
+    }
+    else
+    {
+        pugi::xml_document doc;
+        pugi::xml_parse_result result = doc.load_buffer (data, size);
+        loaded = result.status == pugi::status_ok && presetData->readFromXML (&doc);
+    }
+    
+    if (!loaded)
+    {
+        res = presetNotLoaded;
+        return nullptr;
+    }
+    
+    cache.push_front ({ name, presetData });
+    if (static_cast<int> (cache.size()) > cacheSize)
+        cache.pop_back();
+    
+    res = success;
+    return presetData;
+}
+
+int PresetIndex::getNumCachedPresets()
+{
+    const std::lock_guard<std::mutex> lock (cacheMutex);
+    return static_cast<int> (cache.size());
+}
+
+void PresetIndex::clearCache()
+{
+    const std::lock_guard<std::mutex> lock (cacheMutex);
+    cache.clear();
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    PresetIndex.h
+    Created: 19 Oct 2026 3:41:07pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+#include "PresetData.h"
+
+/*  Index over the presets embedded in BinaryData. Only the name, pointer and size of every resource are stored up front. A preset is parsed on first use and kept in a small least-recently-used cache, so that only the presets that are actually selected are ever parsed.
+ 
+    Can be accessed from both the message thread and the preset loading thread.
+ */
+class PresetIndex
+{
+public:
+    PresetIndex (int cacheSizeToSet = Global::presetCacheSize);
+    ~PresetIndex() {};
+
+    // Returns the parsed preset (nullptr if it is not in BinaryData or could not be read)
+    std::shared_ptr<const PresetData> getPreset (const String& name, PresetResult& res);
+
+    bool contains (const String& name) const { return index.find (name) != index.end(); };
+    int getNumIndexedPresets() const { return static_cast<int> (index.size()); };
+    int getNumCachedPresets();
+
+    void clearCache();
+
+private:
+    struct Entry
+    {
+        const char* data;
+        int size;
+    };
+
+    std::map<String, Entry> index; // built once, read-only afterwards
+
+    // most recently used preset first
+    std::list<std::pair<String, std::shared_ptr<const PresetData>>> cache;
+    int cacheSize;
+    std::mutex cacheMutex;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetIndex)
+};
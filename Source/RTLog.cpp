@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    RTLog.cpp
+    Created: 19 Oct 2026 6:03:44pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "RTLog.h"
+#include "DebugCPP.h"
+
+// the positions wrap around at 2^32, which only maps to the same slots if the size is a power of two
+static_assert ((Global::rtLogSize & (Global::rtLogSize - 1)) == 0, "Global::rtLogSize should be a power of two");
+
+std::atomic<RTLog*> RTLog::instance { nullptr };
+std::atomic<int> RTLog::numPosting { 0 };
+
+RTLog::RTLog() : Thread ("RTLog")
+{
+    slots.reset (new Slot[Global::rtLogSize]);
+    for (uint32 i = 0; i < static_cast<uint32> (Global::rtLogSize); ++i)
+        slots[i].sequence = i;
+    instance = this;
+    startThread();
+}
+
+RTLog::~RTLog()
+{
+    instance = nullptr;
+    while (numPosting.load() > 0)
+        Thread::yield();
+    stopThread (1000);
+    
+    // write what is left
+    drain();
+}
+
+void RTLog::post (RTLogMessage message, int id, double value1, double value2)
+{
+    ++numPosting;
+    RTLog* log = instance.load();
+    if (log == nullptr)
+    {
+        --numPosting;
+        return;
+    }
+    
+    uint32 pos = log->writePos.load (std::memory_order_relaxed);
+    while (true)
+    {
+        Slot& slot = log->slots[pos % Global::rtLogSize];
+        int32 diff = static_cast<int32> (slot.sequence.load (std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            // claim the slot (pos is updated if another producer was first)
+            if (log->writePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.record = { message, id, value1, value2 };
+                slot.sequence.store (pos + 1, std::memory_order_release);
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the slot has not been drained yet, i.e., the buffer is full
+            ++log->numDroppedRecords;
+            break;
+        }
+        else
+        {
+            pos = log->writePos.load (std::memory_order_relaxed);
+        }
+    }
+    --numPosting;
+}
+
+void RTLog::setDestination (RTLogDestination d, File fileToSet)
+{
+    const std::lock_guard<std::mutex> lock (destinationMutex);
+    destination = d;
+    fileStream.reset();
+    if (destination == RTLogDestination::file)
+    {
+        fileStream = std::make_unique<FileOutputStream> (fileToSet);
+        if (fileStream->failedToOpen())
+        {
+            DBG ("RTLog: could not open " + fileToSet.getFullPathName());
+            fileStream.reset();
+            destination = RTLogDestination::standardOutput;
+        }
+    }
+}
+
+void RTLog::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait (Global::rtLogDrainInterval);
+    }
+}
+
+void RTLog::drain()
+{
+    // stops at the first slot that has not been published yet (it is drained the next time)
+    while (true)
+    {
+        Slot& slot = slots[readPos % Global::rtLogSize];
+        if (slot.sequence.load (std::memory_order_acquire) != readPos + 1)
+            break;
+        write (getMessageText (slot.record));
+        slot.sequence.store (readPos + Global::rtLogSize, std::memory_order_release);
+        ++readPos;
+    }
+    
+    int numDropped = numDroppedRecords.exchange (0);
+    if (numDropped > 0)
+        write (String (numDropped) + " log records were dropped");
+}
+
+void RTLog::write (const String& text)
+{
+    const std::lock_guard<std::mutex> lock (destinationMutex);
+    switch (destination)
+    {
+        case RTLogDestination::debugLog:
+            Debug::Log (text.toStdString());
+            break;
+        case RTLogDestination::standardOutput:
+            std::cout << text << std::endl;
+            break;
+        case RTLogDestination::file:
+            if (fileStream != nullptr)
+            {
+                *fileStream << text << newLine;
+                fileStream->flush();
+            }
+            break;
+    }
+}
+
+String RTLog::getMessageText (const Record& record)
+{
+    String idText = record.id == -1 ? "" : String (record.id) + ": ";
+    switch (record.message)
+    {
+        case RTLogMessage::bowNotConverged:
+            return idText + "Bow did not converge after " + String (record.value1) + " iterations";
+        case RTLogMessage::interactionForceIsNan:
+            return "Force of connection " + String (record.value1) + " is NaN";
+        case RTLogMessage::decompositionFailed:
+            return "decomposition failed";
+        case RTLogMessage::solvingFailed:
+            return "solving failed";
+        case RTLogMessage::exciterForceTooLarge:
+            return idText + "Details: etaStar - etaPrev: " + String (record.value1) + " g: " + String (record.value2);
+        case RTLogMessage::exciterStatesReset:
+            return idText + "States are set to zero";
+        case RTLogMessage::exciterStateIsNan:
+            return idText + "State of the exciter is NaN";
+        case RTLogMessage::exciterInterpolationIsNan:
+            return idText + "Interpolation of the exciter is NaN";
+        case RTLogMessage::exciterNotMadeFor2D:
+            return idText + "Not made for 2D yet!!";
+        case RTLogMessage::exciterStiffness:
+            return idText + "g: " + String (record.value1);
+        case RTLogMessage::plucked:
+            return idText + "plucked! (force: " + String (record.value1) + ")";
+        case RTLogMessage::doneRecording:
+            return idText + "Done recording? (within res) " + String (record.value1 != 0 ? "true" : "false");
+    }
+    return {};
+}
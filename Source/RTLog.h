@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    RTLog.h
+    Created: 19 Oct 2026 6:03:44pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+// Messages that can be logged from the audio thread. The text belonging to each message is only created by the drain thread (see RTLog::getMessageText).
+enum class RTLogMessage
+{
+    bowNotConverged,        // value1: number of Newton-Raphson iterations
+    interactionForceIsNan,  // value1: connection index
+    decompositionFailed,
+    solvingFailed,
+    exciterForceTooLarge,   // value1: etaStar - etaPrev, value2: g
+    exciterStatesReset,
+    exciterStateIsNan,
+    exciterInterpolationIsNan,
+    exciterNotMadeFor2D,
+    exciterStiffness,       // value1: g
+    plucked,                // value1: force
+    doneRecording           // value1: done recording (0 or 1)
+};
+
+enum class RTLogDestination
+{
+    debugLog,       // Debug::Log (Unity)
+    standardOutput,
+    file
+};
+
+/*  Lock-free and allocation-free logging for the audio thread. post() copies a small typed record into a preallocated ring buffer (records are dropped when it is full) and a background thread formats the records and writes them to the destination.
+ 
+    Multiple producers: the audio threads of all plugin instances and the worker threads (see WorkerPool) can post at the same time. A producer claims a slot by advancing the write position with a compare-and-swap and publishes the record through the sequence number of the slot. Keep an instance alive (e.g. a SharedResourcePointer in the processor) for the records to be drained; without an instance post() does nothing.
+ */
+class RTLog : private Thread
+{
+public:
+    RTLog();
+    ~RTLog() override;
+    
+    struct Record
+    {
+        RTLogMessage message;
+        int id;         // ID of the resonator or exciter module (-1 if not applicable)
+        double value1;
+        double value2;
+    };
+    
+    // Audio thread (or any other thread)
+    static void post (RTLogMessage message, int id = -1, double value1 = 0.0, double value2 = 0.0);
+
+    // Message thread
+    void setDestination (RTLogDestination d, File fileToSet = File());
+    int getNumDroppedRecords() { return numDroppedRecords.load(); };
+    
+    static String getMessageText (const Record& record);
+
+private:
+    void run() override;
+    void drain();
+    void write (const String& text);
+    
+    static std::atomic<RTLog*> instance;
+    static std::atomic<int> numPosting; // producers that might still use the instance
+    
+    // A slot can be written when its sequence equals the write position and read when it equals the read position + 1
+    struct Slot
+    {
+        std::atomic<uint32> sequence { 0 };
+        Record record;
+    };
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint32> writePos { 0 };
+    uint32 readPos = 0; // only used by the drain thread
+    std::atomic<int> numDroppedRecords { 0 };
+    
+    std::mutex destinationMutex;
+    RTLogDestination destination = RTLogDestination::standardOutput;
+    std::unique_ptr<FileOutputStream> fileStream;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RTLog)
+};
@@ -12,7 +12,7 @@
 #include "ResonatorModule.h"
 
 //==============================================================================
-ResonatorModule::ResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo, BoundaryCondition bc) : k (1.0 / fs), inOutInfo (inOutInfo), bc (bc), ID (ID), resonatorModuleType(rmt), parameters (parameters)
+ResonatorModule::ResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo, BoundaryCondition bc) : k (1.0 / fs), inOutInfo (inOutInfo), bc (bc), ID (ID), resonatorModuleType(rmt), parameters (parameters), processingMode (processingMode)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -20,6 +20,9 @@ ResonatorModule::ResonatorModule (ResonatorModuleType rmt, NamedValueSet& parame
         is1D = true;
     else
         is1D = false;
+    
+    // allocated for the largest real-time grid so that nothing is allocated on the audio thread (larger grids are decimated further)
+    visualSnapshot = std::make_unique<VisualSnapshot> (is1D ? 2 * (Global::maxIntervals1D[realTimeMode] + 1) : Global::maxPoints2D[realTimeMode] + 1);
     addChangeListener (instrument);
 }
 
@@ -33,29 +36,9 @@ bool ResonatorModule::initialiseModule()
 //    jassert (N > 0);
     
     // Limit on number of points
-    if (is1D)
-    {
-        if (N > 1000)
-        {
-            errorMsg = "Too many points!";
-            return false;
-        } else if (N < 5)
-        {
-            errorMsg = "Too few points!";
-            return false;
-        }
-    } else {
-        if (N > 10000)
-        {
-            errorMsg = "Too many points!";
-            return false;
-        }
-        if (Nx < 5 || Ny < 5)
-        {
-            errorMsg = "Too few points!";
-            return false;
-        }
-    }
+    if (!checkGridSize (N, Nx, Ny))
+        return false;
+
     canInitialise = true;
     
 
@@ -71,14 +54,13 @@ bool ResonatorModule::initialiseModule()
     uStates = std::vector<std::vector<double>> (3,
                                         std::vector<double>(N+1, 0));
 
-    // Initialise pointer vector
-    u.resize (3, nullptr);
-    
     // Make set memory addresses to first index of the state vectors.
     for (int i = 0; i < 3; ++i)
         u[i] = &uStates[i][0];
     
     jassert (connectionDivisionTerm != -1); // connectionDivisionTerm must have been set in module inheriting from this class
+    
+    modulationBase = getModulationBase (parameters);
 
     pluckModule = std::make_shared<Pluck>(getID(), is1D);
     hammerModule = std::make_shared<Hammer>(getID(), is1D);
@@ -89,11 +71,12 @@ bool ResonatorModule::initialiseModule()
     allExciterModules.push_back (hammerModule);
     allExciterModules.push_back (bowModule);
     
-    for (auto exciterModule : allExciterModules)
+    exciterParameters.resize (allExciterModules.size());
+    for (int i = 0; i < allExciterModules.size(); ++i)
     {
-        exciterModule->addChangeListener(this);
-        is1D ? exciterModule->setN (N) : exciterModule->setNxNy (Nx, Ny);
-        initialiseExciterModule (exciterModule);
+        is1D ? allExciterModules[i]->setN (N) : allExciterModules[i]->setNxNy (Nx, Ny);
+        fillExciterParameters (allExciterModules[i]->getExcitationType(), exciterParameters[i]);
+        allExciterModules[i]->initialise (exciterParameters[i]);
     }
     
     curExciterModule = nullptr;
@@ -101,6 +84,35 @@ bool ResonatorModule::initialiseModule()
 
     moduleIsReady = true;
     justReady = true;
+    return true;
+}
+
+bool ResonatorModule::checkGridSize (int NToCheck, int NxToCheck, int NyToCheck)
+{
+    if (is1D)
+    {
+        if (NToCheck > Global::maxIntervals1D[getProcessingMode()])
+        {
+            errorMsg = "Too many points!";
+            return false;
+        } else if (NToCheck < 5)
+        {
+            errorMsg = "Too few points!";
+            return false;
+        }
+    } else {
+        if (NToCheck > Global::maxPoints2D[getProcessingMode()])
+        {
+            errorMsg = "Too many points!";
+            return false;
+        }
+        if (NxToCheck < 5 || NyToCheck < 5)
+        {
+            errorMsg = "Too few points!";
+            return false;
+        }
+    }
+    return true;
 }
 
 void ResonatorModule::setStatesToZero()
@@ -110,6 +122,64 @@ void ResonatorModule::setStatesToZero()
             u[i][j] = 0.0;
 }
 
+bool ResonatorModule::takeStatesToZeroRequest()
+{
+    // take the requests of all exciters, also the ones that have been switched away from
+    bool requested = false;
+    for (auto& exciter : allExciterModules)
+        requested = exciter->takeStatesToZeroRequest() || requested;
+    return requested;
+}
+
+void ResonatorModule::checkSleep()
+{
+    if (!sleepRequested.load())
+    {
+        sleeping = false;
+        return;
+    }
+    
+    // an excitation wakes the module up
+    if (excitationActive || rcExcitationFlag)
+    {
+        sleepRequested = false;
+        sleeping = false;
+        return;
+    }
+    
+    if (!sleeping)
+        setStatesToZero();
+    sleeping = true;
+}
+
+bool ResonatorModule::copyStatesTo (std::vector<std::vector<double>>& statesToFill)
+{
+    if (!moduleIsReady || statesToFill.size() != uStates.size())
+        return false;
+    
+    for (int i = 0; i < uStates.size(); ++i)
+    {
+        if (statesToFill[i].size() != uStates[i].size())
+            return false;
+        std::copy (u[i], u[i] + uStates[i].size(), statesToFill[i].begin());
+    }
+    return true;
+}
+
+bool ResonatorModule::setStatesFrom (const std::vector<std::vector<double>>& statesToSet)
+{
+    if (statesToSet.size() != uStates.size())
+        return false;
+    
+    for (int i = 0; i < uStates.size(); ++i)
+        if (statesToSet[i].size() != uStates[i].size())
+            return false;
+
+    for (int i = 0; i < uStates.size(); ++i)
+        std::copy (statesToSet[i].begin(), statesToSet[i].end(), u[i]);
+    return true;
+}
+
 void ResonatorModule::update()
 {
     double* uTmp = u[2];
@@ -123,6 +193,114 @@ void ResonatorModule::update()
     }
 }
 
+void ResonatorModule::updateVisualSnapshot (int numSamples)
+{
+    samplesSinceVisualSnapshot += numSamples;
+    if (samplesSinceVisualSnapshot * k * Global::visualSnapshotRate < 1.0)
+        return;
+    samplesSinceVisualSnapshot = 0;
+    
+    VisualSnapshot::Frame& frame = visualSnapshot->getWriteFrame();
+    int w = visualWidth;
+    int h = visualHeight;
+    
+    // decimate to (at most) one value per pixel
+    if (is1D)
+    {
+        frame.height = 1;
+        w = jmin (w < 2 ? N+1 : w, visualSnapshot->getCapacity() / 2);
+        if (N+1 <= w)
+        {
+            frame.width = N+1;
+            frame.minMax = false;
+            std::copy (u[1], u[1] + N+1, frame.values.begin());
+        }
+        else
+        {
+            // one min/max pair per pixel column so that no peaks get lost
+            frame.width = w;
+            frame.minMax = true;
+            for (int i = 0; i < w; ++i)
+            {
+                int start = (i * (N+1)) / w;
+                int end = ((i+1) * (N+1)) / w;
+                double minVal = u[1][start];
+                double maxVal = u[1][start];
+                for (int l = start + 1; l < end; ++l)
+                {
+                    minVal = jmin (minVal, u[1][l]);
+                    maxVal = jmax (maxVal, u[1][l]);
+                }
+                frame.values[2 * i] = minVal;
+                frame.values[2 * i + 1] = maxVal;
+            }
+        }
+    }
+    else
+    {
+        frame.width = w < 2 ? Nx+1 : jmin (Nx+1, w);
+        frame.height = h < 2 ? Ny+1 : jmin (Ny+1, h);
+        if (frame.width * frame.height > visualSnapshot->getCapacity())
+        {
+            double scale = std::sqrt (visualSnapshot->getCapacity() / static_cast<double> (frame.width * frame.height));
+            frame.width = jmax (2, static_cast<int> (frame.width * scale));
+            frame.height = jmax (2, static_cast<int> (frame.height * scale));
+        }
+        for (int m = 0; m < frame.height; ++m)
+        {
+            int mGrid = (m * Ny) / (frame.height - 1);
+            for (int l = 0; l < frame.width; ++l)
+                frame.values[l + m * frame.width] = u[1][(l * Nx) / (frame.width - 1) + mGrid * Nx];
+        }
+    }
+    visualSnapshot->publish();
+}
+
+double ResonatorModule::getVisualStateAt (int idx)
+{
+    const VisualSnapshot::Frame& frame = getVisualFrame();
+    if (!frame.hasData())
+        return 0.0;
+    
+    if (is1D)
+    {
+        if (!frame.minMax)
+            return frame.values[jlimit (0, N, idx)];
+        int column = jlimit (0, frame.width - 1, (idx * frame.width) / (N+1));
+        return 0.5 * (frame.values[2 * column] + frame.values[2 * column + 1]);
+    }
+    
+    int l = roundToInt ((idx % Nx) * (frame.width - 1) / static_cast<double> (Nx));
+    int m = roundToInt ((idx / Nx) * (frame.height - 1) / static_cast<double> (Ny));
+    return frame.values[jlimit (0, frame.width - 1, l) + jlimit (0, frame.height - 1, m) * frame.width];
+}
+
+bool ResonatorModule::hasVisualSnapshotChanged()
+{
+    const VisualSnapshot::Frame& frame = getVisualFrame();
+    if (!frame.hasData())
+        return false;
+    
+    int numValues = frame.getNumValues();
+    if (lastCheckedVisualValues.size() != numValues)
+    {
+        lastCheckedVisualValues.assign (frame.values.begin(), frame.values.begin() + numValues);
+        return true;
+    }
+    
+    double maxChange = 0.0;
+    for (int i = 0; i < numValues; ++i)
+        maxChange = jmax (maxChange, std::abs (frame.values[i] - lastCheckedVisualValues[i]));
+    
+    // in pixels (1D) or in grey levels (2D)
+    double visualChange = maxChange * visualScaling * (is1D ? getHeight() : 127.5);
+    if (visualChange < Global::visualChangeThreshold)
+        return false;
+    
+    std::copy (frame.values.begin(), frame.values.begin() + numValues, lastCheckedVisualValues.begin());
+    return true;
+}
+
 double ResonatorModule::getStateAt (int idx, int time)
 {
 //    jassert(connectionLocationIndex >= connectionLocations.size());
@@ -165,22 +343,237 @@ void ResonatorModule::setExcitationType (ExcitationType e)
 
 }
 
-void ResonatorModule::changeListenerCallback (ChangeBroadcaster* changeBroadcaster)
+void ResonatorModule::setBowParams(double newVel)
+{
+    if (getCurExciterModule() != nullptr)
+    {
+        getCurExciterModule()->setControlParameter(newVel);
+        getCurExciterModule()->setForce(abs(newVel * 0.5));
+    }
+}
+
+void ResonatorModule::requestRegrid (NamedValueSet& newParameters)
+{
+    {
+        const std::lock_guard<std::mutex> lock (regridMutex);
+        requestedParameters = newParameters;
+        if (maxPointsLimit > 0 && requestedParameters.contains ("maxPoints")
+            && static_cast<int> (*requestedParameters.getVarPointer ("maxPoints")) > maxPointsLimit)
+            requestedParameters.set ("maxPoints", maxPointsLimit);
+        regridRequested = true;
+    }
+    
+    // the exciter parameters are prepared on the regrid thread, which cannot ask the component for its size
+    setVisualSize (getWidth(), getHeight());
+    
+    // let the instrument know that it should start a regrid job
+    action = regridAction;
+    sendChangeMessage();
+}
+
+void ResonatorModule::prepareRegrid()
+{
+    TraceCapture::Scope traceScope ("prepareRegrid");
+    // The audio thread only tries to lock this, so it will never wait for the regrid to be prepared
+    const std::lock_guard<std::mutex> lock (regridMutex);
+    
+    // already handled by a previous job
+    if (!regridRequested)
+        return;
+    regridRequested = false;
+    
+    // Apply the current modulation to the new parameters
+    pendingTensionMultiplier = targetTensionMultiplier.load();
+    pendingDensityMultiplier = targetDensityMultiplier.load();
+    pendingDampingMultiplier = targetDampingMultiplier.load();
+    
+    pendingModulationBase = getModulationBase (requestedParameters);
+    NamedValueSet modulatedParameters = requestedParameters;
+    if (modulatedParameters.contains ("T"))
+        modulatedParameters.set ("T", pendingModulationBase.T * pendingTensionMultiplier);
+    modulatedParameters.set ("rho", pendingModulationBase.rho * pendingDensityMultiplier);
+    modulatedParameters.set ("sig0", pendingModulationBase.sig0 * pendingDampingMultiplier);
+    modulatedParameters.set ("sig1", pendingModulationBase.sig1 * pendingDampingMultiplier);
+    
+    if (!calculatePendingCoefficients (modulatedParameters))
+        return;
+    
+    if (!checkGridSize (pendingN, pendingNx, pendingNy))
+    {
+        DBG ("Regrid cancelled: " + getErrorMsg());
+        return;
+    }
+    
+    // Allocate the new state vectors here (rather than on the audio thread). This also frees the state vectors from before the previous regrid.
+    pendingStates = std::vector<std::vector<double>> (3, std::vector<double> (pendingN + 1, 0));
+    
+    pendingExciterParameters = std::vector<NamedValueSet> (allExciterModules.size());
+    for (int i = 0; i < allExciterModules.size(); ++i)
+        fillPendingExciterParameters (allExciterModules[i]->getExcitationType(), pendingExciterParameters[i]);
+    
+    regridReady = true;
+}
+
+bool ResonatorModule::applyRegrid()
 {
-    if (changeBroadcaster == curExciterModule.get())
-        if (curExciterModule->getAction() == setStatesToZeroAction)
+    TraceCapture::Scope traceScope ("applyRegrid");
+    std::unique_lock<std::mutex> lock (regridMutex, std::try_to_lock);
+    if (!lock.owns_lock() || !regridReady)
+        return false;
+    
+    // Interpolate u^n and u^{n-1} onto the new grid (u^{n+1} gets calculated by the scheme)
+    for (int n = 1; n < 3; ++n)
+        interpolateState (u[n], &pendingStates[n][0]);
+    
+    // Swapping does not allocate. The old state vectors are kept in pendingStates until the next regrid.
+    uStates.swap (pendingStates);
+    for (int i = 0; i < 3; ++i)
+        u[i] = &uStates[i][0];
+    
+    prevN = N;
+    prevNx = Nx;
+    prevNy = Ny;
+    
+    N = pendingN;
+    Nx = pendingNx;
+    Ny = pendingNy;
+    
+    applyPendingCoefficients();
+    
+    modulationBase = pendingModulationBase;
+    tensionMultiplier = pendingTensionMultiplier;
+    densityMultiplier = pendingDensityMultiplier;
+    dampingMultiplier = pendingDampingMultiplier;
+    modulationRegridRequested = false;
+    
+    // Move the outputs to the closest point on the new grid
+    for (int i = 0; i < inOutInfo.getNumOutputs(); ++i)
+        inOutInfo.setOutLocAt (i, getRegriddedLocation (inOutInfo.getOutLocAt (i)));
+    
+    if (is1D)
+    {
+        inOutInfo.setNAt (0, N);
+    } else {
+        inOutInfo.setNAt (0, Nx);
+        inOutInfo.setNAt (1, Ny);
+    }
+    
+    // Refresh the exciter modules without resetting them. The old parameter sets are kept in pendingExciterParameters until the next regrid.
+    exciterParameters.swap (pendingExciterParameters);
+    for (int i = 0; i < allExciterModules.size(); ++i)
+    {
+        is1D ? allExciterModules[i]->setN (N) : allExciterModules[i]->setNxNy (Nx, Ny);
+        allExciterModules[i]->refreshParameters (exciterParameters[i]);
+    }
+    
+    regridReady = false;
+    return true;
+}
+
+void ResonatorModule::modulateParameters (double tensionMultiplierToSet, double densityMultiplierToSet, double dampingMultiplierToSet)
+{
+    // multipliers need to be positive
+    if (tensionMultiplierToSet <= 0 || densityMultiplierToSet <= 0 || dampingMultiplierToSet <= 0)
+        return;
+    
+    targetTensionMultiplier = tensionMultiplierToSet;
+    targetDensityMultiplier = densityMultiplierToSet;
+    targetDampingMultiplier = dampingMultiplierToSet;
+
+    if (tensionMultiplierToSet == tensionMultiplier
+        && densityMultiplierToSet == densityMultiplier
+        && dampingMultiplierToSet == dampingMultiplier)
+        return;
+    
+    // try again next block if a regrid is being prepared. The coefficients would be overwritten by a pending regrid anyway.
+    std::unique_lock<std::mutex> lock (regridMutex, std::try_to_lock);
+    if (!lock.owns_lock() || regridReady)
+        return;
+    
+    if (refreshCoefficientsAtFixedGrid (modulationBase.T * tensionMultiplierToSet,
+                                        modulationBase.rho * densityMultiplierToSet,
+                                        modulationBase.sig0 * dampingMultiplierToSet,
+                                        modulationBase.sig1 * dampingMultiplierToSet))
+    {
+        tensionMultiplier = tensionMultiplierToSet;
+        densityMultiplier = densityMultiplierToSet;
+        dampingMultiplier = dampingMultiplierToSet;
+        modulationRegridRequested = false;
+        
+        // the parameter sets already contain all parameters, so this does not allocate
+        for (int i = 0; i < allExciterModules.size(); ++i)
         {
-            action = setStatesToZeroAction;
-            sendChangeMessage();
-            curExciterModule->setAction (noAction);
+            fillExciterParameters (allExciterModules[i]->getExcitationType(), exciterParameters[i]);
+            allExciterModules[i]->refreshParameters (exciterParameters[i]);
         }
+        return;
+    }
+    
+    // The current grid is unstable for the new parameters. The regrid is requested from the message thread (only once until it has been applied), which polls the flag rather than being sent a message from here.
+    if (!modulationRegridRequested)
+    {
+        modulationRegridRequested = true;
+        modulationRegridNeeded = true;
+    }
 }
 
-void ResonatorModule::setBowParams(double newVel)
+bool ResonatorModule::requestModulationRegrid()
 {
-    if (getCurExciterModule() != nullptr)
+    if (!modulationRegridNeeded.exchange (false))
+        return false;
+    
+    requestRegrid (getParameters());
+    return true;
+}
+
+ResonatorModule::ModulationBase ResonatorModule::getModulationBase (NamedValueSet& p)
+{
+    ModulationBase base;
+    if (p.contains ("T"))
+        base.T = *p.getVarPointer ("T");
+    base.rho = *p.getVarPointer ("rho");
+    base.sig0 = *p.getVarPointer ("sig0");
+    base.sig1 = *p.getVarPointer ("sig1");
+    return base;
+}
+
+void ResonatorModule::interpolateState (double* uFrom, double* uTo)
+{
+    // the points at the edges that are not updated by the scheme stay 0
+    int boundaryPoints = (bc == clampedBC) ? 2 : 1;
+    
+    if (is1D)
     {
-        getCurExciterModule()->setControlParameter(newVel);
-        getCurExciterModule()->setForce(abs(newVel * 0.5));
+        for (int l = boundaryPoints; l <= pendingN - boundaryPoints; ++l)
+        {
+            double loc = l * static_cast<double> (N) / pendingN;
+            int bp = std::min (static_cast<int> (loc), N - 1);
+            double alpha = loc - bp;
+            uTo[l] = (1.0 - alpha) * uFrom[bp] + alpha * uFrom[bp + 1];
+        }
+    } else {
+        for (int m = boundaryPoints; m <= pendingNy - boundaryPoints; ++m)
+        {
+            double locY = m * static_cast<double> (Ny) / pendingNy;
+            int bpY = std::min (static_cast<int> (locY), Ny - 1);
+            for (int l = boundaryPoints; l <= pendingNx - boundaryPoints; ++l)
+            {
+                double locX = l * static_cast<double> (Nx) / pendingNx;
+                int bpX = std::min (static_cast<int> (locX), Nx - 1);
+                uTo[l + m * pendingNx] = Global::interpolation2D (uFrom, bpX, bpY, locX - bpX, locY - bpY, Nx);
+            }
+        }
     }
 }
+
+int ResonatorModule::getRegriddedLocation (int loc)
+{
+    int boundaryPoints = (bc == clampedBC) ? 2 : 1;
+    
+    if (is1D)
+        return Global::limit (round (loc * static_cast<double> (N) / prevN), boundaryPoints, N - boundaryPoints);
+    
+    int locX = Global::limit (round ((loc % prevNx) * static_cast<double> (Nx) / prevNx), boundaryPoints, Nx - boundaryPoints);
+    int locY = Global::limit (round ((loc / prevNx) * static_cast<double> (Ny) / prevNy), boundaryPoints, Ny - boundaryPoints);
+    return locX + locY * Nx;
+}
@@ -17,21 +17,24 @@
 #include "Hammer.h"
 #include "Bow.h"
 #include "InOutInfo.h"
+#include "VisualSnapshot.h"
+#include "TraceCapture.h"
 //==============================================================================
 /*
  Things that need to be initialised in the constructor of a resonator module (inheriting from this class):
     -initialise module
 */
 
-class ResonatorModule  : public juce::Component, public ChangeBroadcaster, public ChangeListener//, public Timer
+class ResonatorModule  : public juce::Component, public ChangeBroadcaster//, public Timer
 {
 public:
-    ResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = clampedBC);
+    ResonatorModule (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = clampedBC);
     ~ResonatorModule() override;
     
     virtual void initialise (int fs) = 0;
     virtual void refreshCoefficients() = 0; // if e.g. density is changed
     void setStatesToZero();
+    bool takeStatesToZeroRequest(); // true if one of the exciters has asked for the states to be zeroed (audio thread)
     
     bool isModuleReady() { return moduleIsReady; };
     bool isJustReady() { return justReady; };
@@ -41,6 +44,13 @@ public:
 
     // Scheme functions
     virtual void calculate() = 0;   // Calculate the FD scheme
+#ifdef KERNEL_EQUIVALENCE_CHECK
+    virtual void calculateReference() = 0; // Plain scalar version of calculate() that optimised versions are checked against. Do not optimise!
+#endif
+    
+    // Row-band decomposition of calculate() (see Instrument::calculateResonator). A band only writes to its own rows of u[0], so all bands of a module can be calculated at the same time.
+    virtual int getNumCalculateBands (int numCores) { return 1; };
+    virtual void calculateBand (int bandIdx, int numBands) { if (bandIdx == 0) calculate(); };
     void update();                  // Update internal system states
     
     // Connection
@@ -60,10 +70,11 @@ public:
         
     // Raised cosine excitation
     bool shouldExciteRaisedCos() { return rcExcitationFlag; };
+    void triggerRaisedCos() { rcExcitationFlag = true; }; // excites at the next call to Instrument::checkIfShouldExciteRaisedCos
     virtual void exciteRaisedCos() {};
     
     // Excite using excitation module
-    void excite() { if (excitationActive) getCurExciterModule()->calculate (u); };
+    void excite() { if (excitationActive) curExciterModule->calculate (u); };
 
     void setApplicationState (ApplicationState a) { applicationState = a; };
     
@@ -129,23 +140,18 @@ public:
     
     std::shared_ptr<ExciterModule> getCurExciterModule() { return curExciterModule; };
     std::shared_ptr<Hammer> getHammerModule() { return hammerModule; };
-    virtual void initialiseExciterModule (std::shared_ptr<ExciterModule>) {};
     
     long getCalcCounter() { return calcCounter; };
 
     bool isChildOfHighlightedInstrument() { return childOfHighlightedInstrument; };
     void setChildOfHighlightedInstrument (bool c) { childOfHighlightedInstrument = c; };
     
-    void changeListenerCallback (ChangeBroadcaster* changeBroadcaster) override;
-    
     Action getAction() { return action; };
     void setAction (Action a) { action = a; };
 
     virtual void saveOutput() {};
     bool isDoneRecording() {
-        if (doneRecording)
-            std::cout << "donerecording = true" << std::endl;
-        std::cout << "Done recording? (within res) " << doneRecording << std::endl;
+        RTLog::post (RTLogMessage::doneRecording, ID, doneRecording ? 1.0 : 0.0);
         return doneRecording;
     };
     
@@ -164,7 +170,10 @@ public:
     void setEnteredThisResonator (bool e) { enteredThisResonator = e; };
     bool hasEnteredThisResonator() { return enteredThisResonator; };
     
+    // Parameter edits while the application is running. These keep the module sounding: the new grid is prepared in the background (see requestRegrid).
     virtual void changeDensity (double rhoToSet) = 0;
+    virtual void changeTension (double TToSet) = 0;
+    virtual void changeDimensions (double LxToSet, double LyToSet) = 0; // LyToSet is ignored by 1D modules
     
     void mouseEnter (const MouseEvent& e) override {
         if (isPartOfGroup())
@@ -200,16 +209,91 @@ public:
     String getErrorMsg() { return errorMsg; };
     bool ableToInitialise() { return canInitialise; };
     
+    // The processing mode of the plugin instance that the module belongs to (set at construction) determines the limits on its grid size (Global::maxIntervals1D and Global::maxPoints2D)
+    ProcessingMode getProcessingMode() { return processingMode; };
+    
+    /*  Regridding. Called when the parameters of a module change while the application is running:
+            - requestRegrid (message thread) stores the new parameters and lets the instrument know,
+            - prepareRegrid (background thread) calculates the new grid and coefficients and allocates the new state vectors,
+            - applyRegrid (audio thread, at the start of a block) interpolates the current state onto the new grid and swaps it in.
+     */
+    void requestRegrid (NamedValueSet& newParameters);
+    void setMaxPointsLimit (int m) { maxPointsLimit = m; }; // overrides the maxPoints parameter of 2D modules at the next regrid if lower (-1 for no limit)
+    int getMaxPointsLimit() { return maxPointsLimit; };
+    void prepareRegrid();
+    bool isRegridReady() { return regridReady.load(); };
+    bool applyRegrid();
+    
+    /*  Load shedding (see LoadGovernor). A sleeping module is not calculated or updated (its states are set to zero so its output is zero):
+            - requestSleep (message thread),
+            - checkSleep (audio thread, at the start of a block) puts the module to sleep or wakes it up. A module also wakes up by itself when it gets excited.
+     */
+    void requestSleep (bool s) { sleepRequested = s; };
+    bool isSleepRequested() { return sleepRequested.load(); };
+    void checkSleep();
+    bool isSleeping() { return sleeping; };
+    
+    // Returns the location (index) on the new grid closest to a location on the grid before the last regrid
+    int getRegriddedLocation (int loc);
+    
+    /*  Real-time modulation of the tension, density and damping (e.g. for pitch bends or vibrato). The multipliers are relative to the parameters of the module. Called on the audio thread at the start of a block:
+            - if the current grid spacing is still stable for the modulated parameters, only the coefficients are refreshed (no allocation),
+            - otherwise a regrid is requested (with the modulation applied to the new parameters).
+     */
+    void modulateParameters (double tensionMultiplier, double densityMultiplier, double dampingMultiplier);
+    
+    // Message thread. Requests the regrid that modulateParameters asked for (if any). Returns true if a regrid was requested.
+    bool requestModulationRegrid();
+    
+    // Session snapshots. The state vectors are copied in the order of u (u^{n+1}, u^n, u^{n-1}). Nothing is allocated: both functions return false if the sizes do not match.
+    int getNumStateVectors() { return static_cast<int> (uStates.size()); };
+    int getStateVectorSize() { return uStates.size() == 0 ? 0 : static_cast<int> (uStates[0].size()); };
+    bool copyStatesTo (std::vector<std::vector<double>>& statesToFill);
+    bool setStatesFrom (const std::vector<std::vector<double>>& statesToSet);
+    
+    /*  Visualisation. The editor never reads the states directly:
+            - updateVisualSnapshot (audio thread, after every block) publishes u^n, decimated to the size of the component, at Global::visualSnapshotRate,
+            - getVisualFrame and getVisualStateAt (message thread) read the latest published snapshot.
+     */
+    void updateVisualSnapshot (int numSamples);
+    const VisualSnapshot::Frame& getVisualFrame() { return visualSnapshot->getReadFrame(); };
+    double getVisualStateAt (int idx);
+    
+    // Message thread. Returns true if the latest snapshot moved far enough (Global::visualChangeThreshold) from the one that was checked last.
+    bool hasVisualSnapshotChanged();
+    void setVisualSize (int w, int h) { visualWidth = w; visualHeight = h; }; // call in resized()
+    
 protected:
     // Initialises the module. Must be called at the end of the constructor of the module inheriting from ResonatorModule
     bool initialiseModule();
+    
+    // Checks whether the grid is within the limits of the application (sets the error message if not)
+    bool checkGridSize (int NToCheck, int NxToCheck, int NyToCheck);
+    
+    // Regridding functions to be implemented by the module inheriting from this class. calculatePendingCoefficients should set pendingN (and pendingNx and pendingNy for 2D modules)
+    virtual bool calculatePendingCoefficients (NamedValueSet& newParameters) { return false; };
+    virtual void applyPendingCoefficients() {};
+    
+    // Sets the parameters that the exciter modules need from the resonator. When the set already contains the parameters, they are overwritten without allocating.
+    virtual void fillExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) {};
+    virtual void fillPendingExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) {};
+    
+    // Refreshes the coefficients at the current grid using the given (modulated) model parameters. Should return false (without changing anything) if the current grid spacing would become unstable. TToSet is ignored by modules without tension.
+    virtual bool refreshCoefficientsAtFixedGrid (double TToSet, double rhoToSet, double sig0ToSet, double sig1ToSet) { return false; };
+    
+    // Height of the component as last set on the message thread (see setVisualSize). Use this instead of getHeight() in anything that can run off the message thread.
+    int getResonatorHeight() { return visualHeight.load(); };
 
     virtual double getKinEnergy() = 0;
     virtual double getPotEnergy() = 0;
     virtual double getDampEnergy() = 0;
     virtual double getInputEnergy() = 0;
     
-    double k;
+    //==============================================================================
+    /*  Simulation core: everything that the audio thread touches every sample (calculate, update, the connections and the exciters). It starts on its own cache line and is kept compact, so that it does not get spread out between the Component, the parameters and the editing state that the message thread writes to. Once the module is running, only the audio thread writes to it (see applyRegrid and modulateParameters); the Component functions only read from it.
+        Only add members here that are used every sample and that are not set from the message thread.
+     */
+    alignas (64) double k;
     
     // Number of intervals
     int N = -1;
@@ -218,7 +302,17 @@ protected:
     int Nx = -1;
     int Ny = -1;
     
-    std::vector<double*> u;                     // state pointers
+    double* u[3] = { nullptr, nullptr, nullptr }; // state pointers (see initialiseModule)
+    double connectionDivisionTerm = -1;
+    bool sleeping = false; // see checkSleep
+    
+    //==============================================================================
+    // Everything below is cold (starts on a new cache line so that message-thread writes do not share a line with the core)
+    
+    // Excitation state. Read every sample, but set from the message thread (setExcitationType and setExcitationActive), so kept out of the core
+    alignas (64) std::shared_ptr<ExciterModule> curExciterModule;
+    bool excitationActive = (Global::bowAtStartup || Global::pluckAtStartup) ? true : false;
+    
     std::vector<std::vector<double>> uStates;   // state vectors
     
     InOutInfo inOutInfo;
@@ -245,7 +339,15 @@ protected:
     bool doneRecording = false;
     int currentlySelectedResonatorGroup = 0;
     
+    // Grid size after the next regrid
+    int pendingN = -1;
+    int pendingNx = -1;
+    int pendingNy = -1;
+    
 private:
+    // Interpolates a state vector onto the pending grid
+    void interpolateState (double* uFrom, double* uTo);
+    
     int ID; // Holds the index in the vector of resonator modules in the instrument
     bool moduleIsReady = false; // Becomes true when the u vectors are initialised
     bool justReady = false; // Becomes true when the u vectors are initialised
@@ -255,7 +357,6 @@ private:
 
     Action action = noAction;
     
-    double connectionDivisionTerm = -1;
     ModifierKeys modifier; // modifier for connections (left / right mouse click + click-n-drag with ctrl)
     
     NamedValueSet parameters;
@@ -264,16 +365,14 @@ private:
     int totOutputs = 0;
     
     ExcitationType excitationType = noExcitation;
-    std::shared_ptr<ExciterModule> curExciterModule;
     
     std::shared_ptr<Pluck> pluckModule;
     std::shared_ptr<Hammer> hammerModule;
     std::shared_ptr<Bow> bowModule;
     
     std::vector<std::shared_ptr<ExciterModule>> allExciterModules;
+    std::vector<NamedValueSet> exciterParameters; // parameters that the exciter modules have been initialised with
 
-    bool excitationActive = (Global::bowAtStartup || Global::pluckAtStartup) ? true : false;
-    
     bool childOfHighlightedInstrument = false;
     
     int partOfGroup = 0;
@@ -283,6 +382,57 @@ private:
     
     String errorMsg;
     bool canInitialise = false;
+    
+    // Regridding
+    std::mutex regridMutex; // only tried to lock on the audio thread
+    NamedValueSet requestedParameters;
+    bool regridRequested = false;
+    std::atomic<bool> regridReady { false };
+    std::vector<std::vector<double>> pendingStates;
+    std::vector<NamedValueSet> pendingExciterParameters;
+    int maxPointsLimit = -1; // message thread only
+    
+    const ProcessingMode processingMode;
+    
+    // Load shedding
+    std::atomic<bool> sleepRequested { false };
+    
+    // Visualisation
+    std::unique_ptr<VisualSnapshot> visualSnapshot;
+    std::atomic<int> visualWidth { 0 };
+    std::atomic<int> visualHeight { 0 };
+    int samplesSinceVisualSnapshot = 0;
+    std::vector<double> lastCheckedVisualValues;
+    
+    // Grid size before the last regrid
+    int prevN = -1;
+    int prevNx = -1;
+    int prevNy = -1;
+    
+    // Modulation. The targets are set on the audio thread and used when a regrid is prepared
+    // The multipliers are always applied to these unmodulated model parameters (rather than to the members of the module, which would make them drift). Taken from the parameters that the grid was last calculated for.
+    struct ModulationBase
+    {
+        double T = 0.0, rho = 0.0, sig0 = 0.0, sig1 = 0.0;
+    };
+    static ModulationBase getModulationBase (NamedValueSet& p);
+    ModulationBase modulationBase;
+    ModulationBase pendingModulationBase;
+    
+    std::atomic<double> targetTensionMultiplier { 1.0 };
+    std::atomic<double> targetDensityMultiplier { 1.0 };
+    std::atomic<double> targetDampingMultiplier { 1.0 };
+    
+    double tensionMultiplier = 1.0;     // currently applied to the coefficients
+    double densityMultiplier = 1.0;
+    double dampingMultiplier = 1.0;
+    
+    double pendingTensionMultiplier = 1.0; // applied to the coefficients of the pending regrid
+    double pendingDensityMultiplier = 1.0;
+    double pendingDampingMultiplier = 1.0;
+    
+    bool modulationRegridRequested = false; // audio thread
+    std::atomic<bool> modulationRegridNeeded { false }; // set on the audio thread, handled on the message thread (see requestModulationRegrid)
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ResonatorModule)
 };
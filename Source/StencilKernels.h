@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    StencilKernels.h
+    Created: 20 Oct 2026 10:14:37am
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+/*  Kernels for the update equations of the resonator modules, generated from a description of the scheme:
+        - the radius of the stencil at u^n (1: second order in space, 2: fourth order (stiffness)). The stencil at u^{n-1} always has radius 1,
+        - the boundary condition (see Boundary).
+
+    Everything that depends on these is resolved at compile time, so every combination gets its own branch-free loop over contiguous rows that the compiler can vectorise. The terms are added in the same order as in the calculateReference() functions of the modules, so the results are identical.
+
+    A module selects its kernel once (see getKernel1D and getKernel2D) and passes its coefficients every time it is called.
+ */
+namespace StencilKernels
+{
+    // Coefficients of u^{n+1} = B * u^n + C * u^{n-1} (see the scheme variables of the modules). Unused coefficients are ignored.
+    struct Coefficients
+    {
+        double B0 = 0.0, B1 = 0.0, B11 = 0.0, B2 = 0.0; // centre, neighbours, diagonal neighbours (2D), neighbours at distance 2
+        double C0 = 0.0, C1 = 0.0;
+        double Bss = 0.0; // centre coefficient of the points next to the boundaries of a simply supported stiff scheme (1D)
+    };
+
+    // Boundary handling of a scheme with a stencil of the given radius
+    template <int radius, BoundaryCondition bc>
+    struct Boundary
+    {
+        static_assert (radius == 1 || radius == 2, "Only stencils with radius 1 or 2 are supported");
+        static_assert (bc != freeBC, "The scheme for the free boundary condition has not been derived yet. Specialise Boundary for it when it is.");
+
+        // first (and, counting from the end, last) point that the interior stencil is applied to. With clamped stiff schemes, the points next to the boundaries stay zero.
+        static const int first = radius;
+
+        // whether the points next to the boundaries need their own update (a simply supported stiff scheme folds its ghost points into Bss)
+        static const bool updateNextToBoundary = (radius == 2 && bc == simplySupportedBC);
+    };
+
+    //==============================================================================
+    // 1D. Updates u[0] on a grid of N intervals.
+    template <int radius, BoundaryCondition bc>
+    void calculate1D (double* const* u, int N, const Coefficients& c)
+    {
+        double* __restrict uNext = u[0];
+        const double* __restrict uCur = u[1];
+        const double* __restrict uPrev = u[2];
+
+        const int first = Boundary<radius, bc>::first;
+        for (int l = first; l <= N - first; ++l)
+        {
+            if (radius == 2)
+                uNext[l] = c.B0 * uCur[l] + c.B1 * (uCur[l + 1] + uCur[l - 1]) + c.B2 * (uCur[l + 2] + uCur[l - 2])
+                         + c.C0 * uPrev[l] + c.C1 * (uPrev[l + 1] + uPrev[l - 1]);
+            else
+                uNext[l] = c.B0 * uCur[l] + c.B1 * (uCur[l + 1] + uCur[l - 1])
+                         + c.C0 * uPrev[l] + c.C1 * (uPrev[l + 1] + uPrev[l - 1]);
+        }
+
+        if (Boundary<radius, bc>::updateNextToBoundary)
+        {
+            uNext[1] = c.Bss * uCur[1] + c.B1 * uCur[2] + c.B2 * uCur[3] + c.C0 * uPrev[1] + c.C1 * uPrev[2];
+            uNext[N-1] = c.Bss * uCur[N-1] + c.B1 * uCur[N-2] + c.B2 * uCur[N-3] + c.C0 * uPrev[N-1] + c.C1 * uPrev[N-2];
+        }
+    }
+
+    typedef void (*Kernel1D) (double* const* u, int N, const Coefficients& c);
+
+    template <int radius>
+    Kernel1D getKernel1D (BoundaryCondition bc)
+    {
+        switch (bc)
+        {
+            case simplySupportedBC:
+                return &calculate1D<radius, simplySupportedBC>;
+            case freeBC:
+                DBG ("The free boundary condition is not implemented yet. Using the clamped boundary condition instead.");
+                return &calculate1D<radius, clampedBC>;
+            default:
+                return &calculate1D<radius, clampedBC>;
+        }
+    }
+
+    //==============================================================================
+    /*  2D. Updates the rows from mStart up to (not including) mEnd and columns from lStart up to (not including) lEnd of u[0], where a row has a stride of Nx.
+        The caller chooses the ranges (see Boundary<radius, bc>::first for the full grid), so that the grid can be split into bands and column strips.
+     */
+    template <int radius, BoundaryCondition bc>
+    void calculate2D (double* const* u, int Nx, int mStart, int mEnd, int lStart, int lEnd, const Coefficients& c)
+    {
+        static_assert (!Boundary<radius, bc>::updateNextToBoundary, "Simply supported stiff 2D schemes are not implemented yet");
+
+        for (int m = mStart; m < mEnd; ++m)
+        {
+            double* __restrict uNext = u[0] + m * Nx;
+            const double* __restrict uCur = u[1] + m * Nx;
+            const double* __restrict uCurUp = uCur + Nx;
+            const double* __restrict uCurDown = uCur - Nx;
+            const double* __restrict uPrev = u[2] + m * Nx;
+            const double* __restrict uPrevUp = uPrev + Nx;
+            const double* __restrict uPrevDown = uPrev - Nx;
+
+            if (radius == 2)
+            {
+                const double* __restrict uCurUp2 = uCur + 2 * Nx;
+                const double* __restrict uCurDown2 = uCur - 2 * Nx;
+                for (int l = lStart; l < lEnd; ++l)
+                    uNext[l] =
+                          c.B0 * uCur[l]
+                        + c.B1 * (uCur[l+1] + uCur[l-1] + uCurUp[l] + uCurDown[l])
+                        + c.B11 * (uCurUp[l+1] + uCurUp[l-1] + uCurDown[l+1] + uCurDown[l-1])
+                        + c.B2 * (uCur[l+2] + uCur[l-2] + uCurUp2[l] + uCurDown2[l])
+                        + c.C0 * uPrev[l]
+                        + c.C1 * (uPrev[l+1] + uPrev[l-1] + uPrevUp[l] + uPrevDown[l]);
+            }
+            else
+            {
+                for (int l = lStart; l < lEnd; ++l)
+                    uNext[l] =
+                          c.B0 * uCur[l]
+                        + c.B1 * (uCur[l+1] + uCur[l-1] + uCurUp[l] + uCurDown[l])
+                        + c.C0 * uPrev[l]
+                        + c.C1 * (uPrev[l+1] + uPrev[l-1] + uPrevUp[l] + uPrevDown[l]);
+            }
+        }
+    }
+
+    typedef void (*Kernel2D) (double* const* u, int Nx, int mStart, int mEnd, int lStart, int lEnd, const Coefficients& c);
+
+    template <int radius>
+    Kernel2D getKernel2D (BoundaryCondition bc)
+    {
+        switch (bc)
+        {
+            case simplySupportedBC:
+                if (radius == 1)
+                    return &calculate2D<1, simplySupportedBC>;
+                DBG ("The simply supported boundary condition is not implemented for stiff 2D schemes yet. Using the clamped boundary condition instead.");
+                return &calculate2D<radius, clampedBC>;
+            case freeBC:
+                DBG ("The free boundary condition is not implemented yet. Using the clamped boundary condition instead.");
+                return &calculate2D<radius, clampedBC>;
+            default:
+                return &calculate2D<radius, clampedBC>;
+        }
+    }
+}
@@ -12,7 +12,7 @@
 #include "StiffMembrane.h"
 
 //==============================================================================
-StiffMembrane::StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo, BoundaryCondition bc) : ResonatorModule (rmt, parameters, advanced, fs, ID, instrument, inOutInfo, bc)
+StiffMembrane::StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo, BoundaryCondition bc) : ResonatorModule (rmt, parameters, advanced, fs, ID, instrument, processingMode, inOutInfo, bc)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -25,6 +25,10 @@ StiffMembrane::StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters
 //    else
 //        test = &StiffMembrane::calculateAll;
     
+    // a membrane has no stiffness terms
+    stencilRadius = rmt == membrane ? 1 : 2;
+    kernel = rmt == membrane ? StencilKernels::getKernel2D<1> (bc) : StencilKernels::getKernel2D<2> (bc);
+    
     if (advanced)
     {
         Lx = *parameters.getVarPointer("Lx");
@@ -185,9 +189,8 @@ StiffMembrane::StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters
     // Initialise paramters
     initialise (fs);
     
-    // Initialise states and connection division term of the system
-    if (!initialiseModule())
-        sendChangeMessage();
+    // Initialise states and connection division term of the system (the instrument checks ableToInitialise after construction)
+    initialiseModule();
     
     std::cout << Nx << " " << Ny << std::endl;
 //    excite(); // start by exciting
@@ -230,85 +233,244 @@ void StiffMembrane::initialise (int fs)
 
 void StiffMembrane::refreshCoefficients()
 {
-    // Calculate wave speed (squared)
-    cSq = T / (rho * H);
-    
-    // Calculate stiffness coefficient (squared)
-    D = E * H * H * H / (12.0 * (1 - nu * nu));
-    kappaSq =  D / (rho * H);
+    Coefficients c = getCoefficients();
+    calculateCoefficients (c);
+    setCoefficients (c);
     
-    double stabilityTerm = cSq * k * k + 4.0 * sig1 * k; // just easier to write down below
-    
-    h = sqrt (stabilityTerm + sqrt ((stabilityTerm * stabilityTerm) + 16.0 * kappaSq * k * k));
-    Nx = floor (Lx / h);
-    Ny = floor (Ly / h);
-    int Nmoving = (Nx - 3) * (Ny - 3) ;
-    if (Nmoving > maxPoints)
+    if (getResonatorModuleType() == membrane)
     {
-        double aspectRatio = Lx / Ly;
-        int NxMoving = floor(sqrt(maxPoints * aspectRatio));
-        int NyMoving = floor(sqrt(maxPoints / aspectRatio));
-        Nx = NxMoving + 3;
-        Ny = NyMoving + 3;
+        std::cout << "This Membrane has " << Nx << "x" << Ny << "points" << std::endl;
     }
-    N = (Nx + 1) * (Ny + 1) - 1; // minus 1 because the resonator module adds one
+}
 
-    h = std::min (Lx / Nx, Ly / Ny); // recalculate h
+StiffMembrane::Coefficients StiffMembrane::getCoefficients()
+{
+    Coefficients c;
+    c.Lx = Lx;
+    c.Ly = Ly;
+    c.rho = rho;
+    c.H = H;
+    c.T = T;
+    c.E = E;
+    c.nu = nu;
+    c.sig0 = sig0;
+    c.sig1 = sig1;
+    c.maxPoints = maxPoints;
     
-    if (getResonatorModuleType() == membrane)
+    c.N = N;
+    c.Nx = Nx;
+    c.Ny = Ny;
+    c.cSq = cSq;
+    c.D = D;
+    c.kappaSq = kappaSq;
+    c.lambdaSq = lambdaSq;
+    c.muSq = muSq;
+    c.h = h;
+    
+    c.Adiv = Adiv;
+    c.B0 = B0;
+    c.B1 = B1;
+    c.B11 = B11;
+    c.B2 = B2;
+    c.C0 = C0;
+    c.C1 = C1;
+    c.S0 = S0;
+    c.S1 = S1;
+    c.Bss = Bss;
+    c.BssC = BssC;
+    c.connDivTerm = getConnectionDivisionTerm();
+    return c;
+}
+
+void StiffMembrane::calculateCoefficients (Coefficients& c)
+{
+    c.h = getMinimumGridSpacing (c);
+    c.Nx = floor (c.Lx / c.h);
+    c.Ny = floor (c.Ly / c.h);
+    int Nmoving = (c.Nx - 3) * (c.Ny - 3) ;
+    
+    // the maxPoints parameter is capped by the limit of the processing mode (leaving room for the boundary points)
+    int pointsLimit = std::min (c.maxPoints, Global::maxPoints2D[getProcessingMode()] * 9 / 10);
+    if (Nmoving > pointsLimit)
     {
-        std::cout << "This Membrane has " << Nx << "x" << Ny << "points" << std::endl;
+        double aspectRatio = c.Lx / c.Ly;
+        int NxMoving = floor(sqrt(pointsLimit * aspectRatio));
+        int NyMoving = floor(sqrt(pointsLimit / aspectRatio));
+        c.Nx = NxMoving + 3;
+        c.Ny = NyMoving + 3;
     }
+    c.N = (c.Nx + 1) * (c.Ny + 1) - 1; // minus 1 because the resonator module adds one
+
+    c.h = std::min (c.Lx / c.Nx, c.Ly / c.Ny); // recalculate h
     
-    lambdaSq = cSq * k * k / (h * h);
-    muSq = kappaSq * k * k / (h * h * h * h);
+    calculateSchemeCoefficients (c);
+}
+
+bool StiffMembrane::calculateCoefficientsAtFixedGrid (Coefficients& c)
+{
+    if (c.h < getMinimumGridSpacing (c))
+        return false;
+    
+    calculateSchemeCoefficients (c);
+    return true;
+}
+
+double StiffMembrane::getMinimumGridSpacing (Coefficients& c)
+{
+    // Calculate wave speed (squared)
+    c.cSq = c.T / (c.rho * c.H);
+    
+    // Calculate stiffness coefficient (squared)
+    c.D = c.E * c.H * c.H * c.H / (12.0 * (1 - c.nu * c.nu));
+    c.kappaSq = c.D / (c.rho * c.H);
+    
+    double stabilityTerm = c.cSq * k * k + 4.0 * c.sig1 * k; // just easier to write down below
+    
+    return sqrt (stabilityTerm + sqrt ((stabilityTerm * stabilityTerm) + 16.0 * c.kappaSq * k * k));
+}
+
+void StiffMembrane::calculateSchemeCoefficients (Coefficients& c)
+{
+    c.lambdaSq = c.cSq * k * k / (c.h * c.h);
+    c.muSq = c.kappaSq * k * k / (c.h * c.h * c.h * c.h);
     
     // Coefficients used for damping
-    S0 = sig0 * k;
-    S1 = (2.0 * sig1 * k) / (h * h);
+    c.S0 = c.sig0 * k;
+    c.S1 = (2.0 * c.sig1 * k) / (c.h * c.h);
 
     // Scheme coefficients
-    B0 = 2.0 - 4.0 * lambdaSq - 20.0 * muSq - 4.0 * S1; // u_l^n
-    B1 = lambdaSq + 8.0 * muSq + S1;                    // u_{lm+-1}^n
-    B11 = -2.0 * muSq;                                  // u_{l+-1, m+-1}^n
-    B2 = -muSq;                                         // u_{l+-2}^n
-    C0 = -1.0 + S0 + 4.0 * S1;                          // u_l^{n-1}
-    C1 = -S1;                                           // u_{l+-1}^{n-1}
+    c.B0 = 2.0 - 4.0 * c.lambdaSq - 20.0 * c.muSq - 4.0 * c.S1; // u_l^n
+    c.B1 = c.lambdaSq + 8.0 * c.muSq + c.S1;                      // u_{lm+-1}^n
+    c.B11 = -2.0 * c.muSq;                                        // u_{l+-1, m+-1}^n
+    c.B2 = -c.muSq;                                               // u_{l+-2}^n
+    c.C0 = -1.0 + c.S0 + 4.0 * c.S1;                              // u_l^{n-1}
+    c.C1 = -c.S1;                                                 // u_{l+-1}^{n-1}
     
-    Bss = 2.0 - 4.0 * lambdaSq - 19.0 * muSq - 4.0 * S1;        // u_l^n Simply supported
-    BssC = 2.0 - 4.0 * lambdaSq - 18.0 * muSq - 4.0 * S1;  // u_l^n Simply supported (corner)
+    c.Bss = 2.0 - 4.0 * c.lambdaSq - 19.0 * c.muSq - 4.0 * c.S1;  // u_l^n Simply supported
+    c.BssC = 2.0 - 4.0 * c.lambdaSq - 18.0 * c.muSq - 4.0 * c.S1; // u_l^n Simply supported (corner)
 
-    Adiv = 1.0 / (1.0 + S0);                           // u_l^{n+1}
+    c.Adiv = 1.0 / (1.0 + c.S0);                                  // u_l^{n+1}
     
     // Divide by u_l^{n+1} term
-    B0 *= Adiv;
-    B1 *= Adiv;
-    B11 *= Adiv;
-    B2 *= Adiv;
-    Bss *= Adiv;
-    BssC *= Adiv;
-    C0 *= Adiv;
-    C1 *= Adiv;
+    c.B0 *= c.Adiv;
+    c.B1 *= c.Adiv;
+    c.B11 *= c.Adiv;
+    c.B2 *= c.Adiv;
+    c.Bss *= c.Adiv;
+    c.BssC *= c.Adiv;
+    c.C0 *= c.Adiv;
+    c.C1 *= c.Adiv;
     
-    setConnectionDivisionTerm (k * k / (rho * H * h * h * (1.0 + sig0 * k)));
+    c.connDivTerm = k * k / (c.rho * c.H * c.h * c.h * (1.0 + c.sig0 * k));
 }
 
+void StiffMembrane::setCoefficients (Coefficients& c)
+{
+    Lx = c.Lx;
+    Ly = c.Ly;
+    rho = c.rho;
+    H = c.H;
+    T = c.T;
+    E = c.E;
+    nu = c.nu;
+    sig0 = c.sig0;
+    sig1 = c.sig1;
+    maxPoints = c.maxPoints;
+    
+    N = c.N;
+    Nx = c.Nx;
+    Ny = c.Ny;
+    cSq = c.cSq;
+    D = c.D;
+    kappaSq = c.kappaSq;
+    lambdaSq = c.lambdaSq;
+    muSq = c.muSq;
+    h = c.h;
+    
+    Adiv = c.Adiv;
+    B0 = c.B0;
+    B1 = c.B1;
+    B11 = c.B11;
+    B2 = c.B2;
+    C0 = c.C0;
+    C1 = c.C1;
+    S0 = c.S0;
+    S1 = c.S1;
+    Bss = c.Bss;
+    BssC = c.BssC;
+    
+    stencil.B0 = B0;
+    stencil.B1 = B1;
+    stencil.B11 = B11;
+    stencil.B2 = B2;
+    stencil.C0 = C0;
+    stencil.C1 = C1;
+    
+    setConnectionDivisionTerm (c.connDivTerm);
+}
+
+bool StiffMembrane::calculatePendingCoefficients (NamedValueSet& newParameters)
+{
+    pendingCoefficients = getCoefficients();
+    pendingCoefficients.Lx = *newParameters.getVarPointer ("Lx");
+    pendingCoefficients.Ly = *newParameters.getVarPointer ("Ly");
+    pendingCoefficients.rho = *newParameters.getVarPointer ("rho");
+    pendingCoefficients.H = *newParameters.getVarPointer ("H");
+    if (newParameters.contains ("T"))
+        pendingCoefficients.T = *newParameters.getVarPointer ("T");
+    if (newParameters.contains ("E"))
+    {
+        pendingCoefficients.E = *newParameters.getVarPointer ("E");
+        pendingCoefficients.nu = *newParameters.getVarPointer ("nu");
+    }
+    pendingCoefficients.sig0 = *newParameters.getVarPointer ("sig0");
+    pendingCoefficients.sig1 = *newParameters.getVarPointer ("sig1");
+    pendingCoefficients.maxPoints = *newParameters.getVarPointer ("maxPoints");
+
+    calculateCoefficients (pendingCoefficients);
+    pendingN = pendingCoefficients.N;
+    pendingNx = pendingCoefficients.Nx;
+    pendingNy = pendingCoefficients.Ny;
+    
+    return true;
+}
+
+bool StiffMembrane::refreshCoefficientsAtFixedGrid (double TToSet, double rhoToSet, double sig0ToSet, double sig1ToSet)
+{
+    Coefficients c = getCoefficients();
+    c.T = TToSet;
+    c.rho = rhoToSet;
+    c.sig0 = sig0ToSet;
+    c.sig1 = sig1ToSet;
+    
+    if (!calculateCoefficientsAtFixedGrid (c))
+        return false;
+    
+    setCoefficients (c);
+    return true;
+}
 
 void StiffMembrane::paint (juce::Graphics& g)
 {
+    TraceCapture::Scope traceScope ("paint2D");
     float stateWidth = getWidth() / static_cast<double> (Nx+1);
     float stateHeight = getHeight() / static_cast<double> (Ny+1);
     
-    for (int l = 0; l <= Nx; ++l)
+    // one pixel per (decimated) grid point, scaled up to the size of the component without interpolation
+    if (renderStateImage())
     {
-        for (int m = 0; m <= Ny; ++m)
-        {
-            int cVal = Global::limit (255 * 0.5 * (u[1][l + m*Nx] * visualScaling + 1), 0, 255);
-            g.setColour(Colour::fromRGBA (cVal, cVal, cVal, 127));
-            g.fillRect(l * stateWidth, m * stateHeight, stateWidth, stateHeight);
-//            g.setColour(Colour::fromRGBA (0, 0, 0, 127));
-            g.drawRect(l * stateWidth, m * stateHeight, stateWidth, stateHeight, 0.5);
-        }
+        g.setImageResamplingQuality (Graphics::lowResamplingQuality);
+        g.drawImage (stateImage, getLocalBounds().toFloat());
+    }
+    
+    // only draw the grid when the grid points are large enough to be distinguished
+    if (jmin (stateWidth, stateHeight) >= Global::minGridLineSpacing)
+    {
+        g.setColour (Colours::black.withAlpha (0.25f));
+        for (int l = 1; l <= Nx; ++l)
+            g.drawVerticalLine (roundToInt (l * stateWidth), 0.0f, static_cast<float> (getHeight()));
+        for (int m = 1; m <= Ny; ++m)
+            g.drawHorizontalLine (roundToInt (m * stateHeight), 0.0f, static_cast<float> (getWidth()));
     }
     if (applicationState == editInOutputsState || Global::alwaysShowInOuts)
     {
@@ -343,10 +505,47 @@ void StiffMembrane::paint (juce::Graphics& g)
 
 }
 
+bool StiffMembrane::renderStateImage()
+{
+    // Only read from the snapshot published by the audio thread
+    const VisualSnapshot::Frame& frame = getVisualFrame();
+    if (!frame.hasData())
+        return false;
+    
+    if (stateImage.getWidth() != frame.width || stateImage.getHeight() != frame.height)
+    {
+        stateImage = Image (Image::ARGB, frame.width, frame.height, true);
+        rowValues.resize (frame.width);
+    }
+    
+    // greyscale with an alpha of 127 (premultiplied) as the colour values of the image are stored premultiplied
+    const uint8 alpha = 127;
+    const double premultiply = alpha / 255.0;
+    
+    Image::BitmapData pixels (stateImage, Image::BitmapData::writeOnly);
+    for (int m = 0; m < frame.height; ++m)
+    {
+        // value to colour for a full row at once: 255 * 0.5 * (u * visualScaling + 1), limited to [0, 255]
+        FloatVectorOperations::copyWithMultiply (rowValues.data(), &frame.values[m * frame.width], 127.5 * visualScaling, frame.width);
+        FloatVectorOperations::add (rowValues.data(), 127.5, frame.width);
+        FloatVectorOperations::clip (rowValues.data(), rowValues.data(), 0.0, 255.0, frame.width);
+        FloatVectorOperations::multiply (rowValues.data(), premultiply, frame.width);
+        
+        PixelARGB* line = reinterpret_cast<PixelARGB*> (pixels.getLinePointer (m));
+        for (int l = 0; l < frame.width; ++l)
+        {
+            const uint8 cVal = static_cast<uint8> (rowValues[l]);
+            line[l].setARGB (alpha, cVal, cVal, cVal);
+        }
+    }
+    return true;
+}
+
 void StiffMembrane::resized()
 {
     // This method is where you should set the bounds of any child
     // components that your component contains..
+    setVisualSize (getWidth(), getHeight());
 
 }
 //
@@ -359,34 +558,83 @@ void StiffMembrane::resized()
 
 void StiffMembrane::calculate()
 {
-    for (int m = 2; m < Ny-1; ++m) // clamped boundaries
-    {
-        for (int l = 2; l < Nx-1; ++l) // clamped boundaries
-        {
-            u[0][l + m*Nx] =
-                  B0 * u[1][l + m*Nx]
-                + B1 * (u[1][l+1 + m*Nx] + u[1][l-1 + m*Nx] + u[1][l + (m+1)*Nx] + u[1][l + (m-1)*Nx])
-                + B11 *(u[1][l+1 + (m+1)*Nx] + u[1][l-1 + (m+1)*Nx] + u[1][l+1 + (m-1)*Nx] + u[1][l-1 + (m-1)*Nx])
-                + B2 * (u[1][l+2 + m*Nx] + u[1][l-2 + m*Nx] + u[1][l + (m+2)*Nx] + u[1][l + (m-2)*Nx])
-                + C0 * u[2][l + m*Nx]
-                + C1 * (u[2][l+1 + m*Nx] + u[2][l-1 + m*Nx] + u[2][l + (m+1)*Nx] + u[2][l + (m-1)*Nx]);
+    calculateRows (getFirstCalculatedRow(), getEndCalculatedRow());
+#ifdef SAVE_OUTPUT
+    ++counter;
+    if (counter >= samplesToRecord)
+        statesSave.close();
+#endif
+}
 
+void StiffMembrane::calculateRows (int mStart, int mEnd)
+{
+    // go through the grid in strips of columns for large grids (see getKernelBlockWidth)
+    int blockWidth = getKernelBlockWidth();
+    int lEnd = Nx + 1 - stencilRadius;
+    for (int lStart = stencilRadius; lStart < lEnd; lStart += blockWidth)
+        kernel (u, Nx, mStart, mEnd, lStart, jmin (lStart + blockWidth, lEnd), stencil);
+    
 #ifdef SAVE_OUTPUT
+    for (int m = mStart; m < mEnd; ++m)
+    {
+        for (int l = stencilRadius; l < lEnd; ++l)
             statesSave << u[1][l + m*Nx] << ",";
+        statesSave << ";\n";
+    }
 #endif
-            
-        }
+}
+
+int StiffMembrane::getKernelBlockWidth()
+{
 #ifdef SAVE_OUTPUT
-        statesSave << ";\n";
+    return Nx; // the states are written to a file row by row
 #endif
-    }
+    // The rows of the stencil are only still in cache when they are reused for the next rows as long as the three states fit in L2. For larger grids (offline) a strip of Global::kernelBlockColumns is calculated for all rows before moving on to the next strip.
+    if (3 * static_cast<size_t> (N+1) * sizeof (double) > static_cast<size_t> (Global::l2CacheBytes))
+        return Global::kernelBlockColumns;
+    return Nx;
+}
+
+int StiffMembrane::getNumCalculateBands (int numCores)
+{
 #ifdef SAVE_OUTPUT
-    ++counter;
-    if (counter >= samplesToRecord)
-        statesSave.close();
+    return 1; // the states are written to a file row by row
 #endif
+    if (numCores < 2 || getNumPoints() < Global::minPointsForBands)
+        return 1;
+    
+    int numRows = getEndCalculatedRow() - getFirstCalculatedRow();
+    
+    // the three states of the rows of a band and its halo rows should fit in L2 together
+    int bytesPerRow = 3 * Nx * sizeof (double);
+    int maxRowsPerBand = jmax (Global::minRowsPerBand, Global::l2CacheBytes / bytesPerRow - 2 * Global::bandHaloRows);
+    int numBands = jmax (numCores, (numRows + maxRowsPerBand - 1) / maxRowsPerBand);
+    
+    return jlimit (1, jmax (1, numRows / Global::minRowsPerBand), numBands);
+}
+
+void StiffMembrane::calculateBand (int bandIdx, int numBands)
+{
+    int firstRow = getFirstCalculatedRow();
+    int numRows = getEndCalculatedRow() - firstRow;
+    calculateRows (firstRow + numRows * bandIdx / numBands, firstRow + numRows * (bandIdx + 1) / numBands);
 }
 
+#ifdef KERNEL_EQUIVALENCE_CHECK
+void StiffMembrane::calculateReference()
+{
+    for (int m = 2; m < Ny-1; ++m)
+        for (int l = 2; l < Nx-1; ++l)
+            u[0][l + m*Nx] =
+                  B0 * u[1][l + m*Nx]
+                + B1 * (u[1][l+1 + m*Nx] + u[1][l-1 + m*Nx] + u[1][l + (m+1)*Nx] + u[1][l + (m-1)*Nx])
+                + B11 *(u[1][l+1 + (m+1)*Nx] + u[1][l-1 + (m+1)*Nx] + u[1][l+1 + (m-1)*Nx] + u[1][l-1 + (m-1)*Nx])
+                + B2 * (u[1][l+2 + m*Nx] + u[1][l-2 + m*Nx] + u[1][l + (m+2)*Nx] + u[1][l + (m-2)*Nx])
+                + C0 * u[2][l + m*Nx]
+                + C1 * (u[2][l+1 + m*Nx] + u[2][l-1 + m*Nx] + u[2][l + (m+1)*Nx] + u[2][l + (m-1)*Nx]);
+}
+#endif
+
 float StiffMembrane::getOutput (int idx)
 {
 //     return u[1][idx] * Global::twoDOutputScaling;
@@ -418,8 +666,6 @@ void StiffMembrane::myMouseEnter (const double x, const double y, bool triggered
     if (getExcitationType() != hammer)
         return;
     
-    getCurExciterModule()->startTimer (1.0 / 150.0);
-
     //    prevYLoc = e.y;
     switch (getExcitationType()) {
         case pluck:
@@ -447,7 +693,6 @@ void StiffMembrane::myMouseExit (const double x, const double y, bool triggeredB
     if (getCurExciterModule() == nullptr) // could happen for 2D objects
         return;
     
-    getCurExciterModule()->stopTimer();
     getCurExciterModule()->mouseExited();
 
     switch (getExcitationType()) {
@@ -529,36 +774,40 @@ double StiffMembrane::getInputEnergy()
     return 0;
 }
 
-void StiffMembrane::initialiseExciterModule (std::shared_ptr<ExciterModule> exciterModule)
+void StiffMembrane::fillExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator)
 {
-    
-    NamedValueSet parametersFromResonator;
-    switch (exciterModule->getExcitationType())
+    Coefficients c = getCoefficients();
+    fillExciterParameters (e, c, parametersFromResonator);
+}
+
+void StiffMembrane::fillExciterParameters (ExcitationType e, Coefficients& c, NamedValueSet& parametersFromResonator)
+{
+    switch (e)
     {
         case pluck:
         case hammer:
-            parametersFromResonator.set ("h", h);
+            parametersFromResonator.set ("h", c.h);
             parametersFromResonator.set ("k", k);
-            parametersFromResonator.set ("rho", rho);
-            parametersFromResonator.set ("H", H);
-            parametersFromResonator.set ("sig0", sig0);
-            parametersFromResonator.set ("connDivTerm", getConnectionDivisionTerm());
-            parametersFromResonator.set ("resHeight", getHeight());
+            parametersFromResonator.set ("rho", c.rho);
+            parametersFromResonator.set ("H", c.H);
+            parametersFromResonator.set ("sig0", c.sig0);
+            parametersFromResonator.set ("connDivTerm", c.connDivTerm);
+            parametersFromResonator.set ("resHeight", getResonatorHeight());
             break;
         case bow:
-            parametersFromResonator.set ("cSq", cSq);
-            parametersFromResonator.set ("kappaSq", kappaSq);
-            parametersFromResonator.set ("h", h);
+            parametersFromResonator.set ("cSq", c.cSq);
+            parametersFromResonator.set ("kappaSq", c.kappaSq);
+            parametersFromResonator.set ("h", c.h);
             parametersFromResonator.set ("k", k);
-            parametersFromResonator.set ("rho", rho);
-            parametersFromResonator.set ("H", H);
-            parametersFromResonator.set ("sig0", sig0);
-            parametersFromResonator.set ("sig1", sig1);
-            parametersFromResonator.set ("connDivTerm", getConnectionDivisionTerm());
+            parametersFromResonator.set ("rho", c.rho);
+            parametersFromResonator.set ("H", c.H);
+            parametersFromResonator.set ("sig0", c.sig0);
+            parametersFromResonator.set ("sig1", c.sig1);
+            parametersFromResonator.set ("connDivTerm", c.connDivTerm);
+            break;
+        default:
             break;
-            
     }
-    exciterModule->initialise (parametersFromResonator);
 }
 
 
@@ -649,17 +898,40 @@ void StiffMembrane::exciteRaisedCos()
 
 void StiffMembrane::changeDensity (double rhoToSet)
 {
-    T = T * rhoToSet / rho;
-    E = E * rhoToSet / rho;
-    rho = rhoToSet;
-    
+    // The members are only changed once the regrid is applied on the audio thread
+    // Use the parameters of the module rather than the members, as the latter might be modulated
     NamedValueSet p = getParameters();
-    p.set ("rho", rho);
+    double ratio = rhoToSet / static_cast<double> (*p.getVarPointer ("rho"));
+    p.set ("rho", rhoToSet);
     if (getResonatorModuleType() != thinPlate)
-        p.set ("T", T);
+        p.set ("T", static_cast<double> (*p.getVarPointer ("T")) * ratio);
     if (getResonatorModuleType() != membrane)
-        p.set ("E", E);
+        p.set ("E", static_cast<double> (*p.getVarPointer ("E")) * ratio);
     setParameters (p);
 
-    refreshCoefficients();
+    requestRegrid (p);
+}
+
+void StiffMembrane::changeTension (double TToSet)
+{
+    NamedValueSet p = getParameters();
+    if (!p.contains ("T"))
+    {
+        DBG ("A thin plate does not have a tension");
+        return;
+    }
+    p.set ("T", TToSet);
+    setParameters (p);
+    
+    requestRegrid (p);
+}
+
+void StiffMembrane::changeDimensions (double LxToSet, double LyToSet)
+{
+    NamedValueSet p = getParameters();
+    p.set ("Lx", LxToSet);
+    p.set ("Ly", LyToSet);
+    setParameters (p);
+    
+    requestRegrid (p);
 }
@@ -13,6 +13,7 @@
 #include <JuceHeader.h>
 #include "Global.h"
 #include "ResonatorModule.h"
+#include "StencilKernels.h"
 
 #include <iostream>
 #include <fstream>
@@ -23,7 +24,7 @@
 class StiffMembrane  : public ResonatorModule
 {
 public:
-    StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = clampedBC);
+    StiffMembrane (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = clampedBC);
     ~StiffMembrane() override;
 
     // initialisation
@@ -35,10 +36,19 @@ public:
     void resized() override;
 
     Path visualiseState (Graphics& g);
+    
+    // Renders the latest visual snapshot into stateImage (one pixel per grid point). Returns false if there is no snapshot yet.
+    bool renderStateImage();
 
     void calculate() override;
+#ifdef KERNEL_EQUIVALENCE_CHECK
+    void calculateReference() override;
+#endif
     void exciteRaisedCos() override;
     
+    int getNumCalculateBands (int numCores) override;
+    void calculateBand (int bandIdx, int numBands) override;
+    
     void onlyCalculateMembrane();
     void calculateAll();
     
@@ -65,10 +75,52 @@ public:
     double getMassPerGridPoint() override { return rho * H * h * h; };
 
     void changeDensity (double rhoToSet) override;
+    void changeTension (double TToSet) override;
+    void changeDimensions (double LxToSet, double LyToSet) override;
+    
+    // Model parameters and everything that follows from them. Can be calculated off the audio thread (used for regridding)
+    struct Coefficients
+    {
+        // model parameters
+        double Lx, Ly, rho, H, T, E, nu, sig0, sig1;
+        int maxPoints;
+        
+        // grid and scheme variables
+        int N, Nx, Ny;
+        double cSq, D, kappaSq, lambdaSq, muSq, h;
+        double Adiv, B0, B1, B11, B2, C0, C1, S0, S1, Bss, BssC;
+        double connDivTerm;
+    };
     
-    void initialiseExciterModule (std::shared_ptr<ExciterModule> exciterModule) override;
+    Coefficients getCoefficients();
+    void calculateCoefficients (Coefficients& c); // calculates everything from the model parameters in c
+    bool calculateCoefficientsAtFixedGrid (Coefficients& c); // same, but keeps Nx, Ny and h. Returns false if h does not satisfy the stability condition
+    void setCoefficients (Coefficients& c);
 
 protected:
+    bool calculatePendingCoefficients (NamedValueSet& newParameters) override;
+    void applyPendingCoefficients() override { setCoefficients (pendingCoefficients); };
+    
+    void fillExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) override;
+    void fillPendingExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) override { fillExciterParameters (e, pendingCoefficients, parametersFromResonator); };
+    void fillExciterParameters (ExcitationType e, Coefficients& c, NamedValueSet& parametersFromResonator);
+    
+    bool refreshCoefficientsAtFixedGrid (double TToSet, double rhoToSet, double sig0ToSet, double sig1ToSet) override;
+    
+    // Calculates the rows from mStart up to (not including) mEnd
+    void calculateRows (int mStart, int mEnd);
+    
+    // Range of rows (and columns) that calculate() updates
+    int getFirstCalculatedRow() { return stencilRadius; };
+    int getEndCalculatedRow() { return Ny + 1 - stencilRadius; };
+    
+    int getKernelBlockWidth(); // in columns
+    
+    double getMinimumGridSpacing (Coefficients& c); // also sets cSq, D and kappaSq
+    void calculateSchemeCoefficients (Coefficients& c); // uses the grid spacing in c
+    
+    Coefficients pendingCoefficients;
+    
     
     int maxPoints;
     
@@ -82,12 +134,21 @@ protected:
         - S for precalculated sigma terms
     */
     double Adiv, B0, B1, B11, B2, C0, C1, S0, S1, Bss, BssC;
+    
+    // kernel for the module type and boundary condition (selected at construction) and the scheme variables it uses. Kept on their own cache line (see the simulation core of ResonatorModule)
+    alignas (64) StencilKernels::Kernel2D kernel;
+    StencilKernels::Coefficients stencil;
+    int stencilRadius;
 
     float excitationLocX = 0.5;
     float excitationLocY = 0.5;
 
     int excitationWidth = 5;
     
+    // Visualisation
+    Image stateImage;
+    std::vector<double> rowValues;
+    
 #ifdef SAVE_OUTPUT
     std::ofstream statesSave;
     int samplesToRecord = 100;
@@ -12,11 +12,13 @@
 #include "StiffString.h"
 
 //==============================================================================
-StiffString::StiffString (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo, BoundaryCondition bc) : ResonatorModule (rmt, parameters, advanced, fs, ID, instrument, inOutInfo, bc)
+StiffString::StiffString (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo, BoundaryCondition bc) : ResonatorModule (rmt, parameters, advanced, fs, ID, instrument, processingMode, inOutInfo, bc)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     
+    kernel = StencilKernels::getKernel1D<2> (bc);
+    
     // Initialise member variables using the parameter set
     if (advanced)
     {
@@ -90,9 +92,8 @@ StiffString::StiffString (ResonatorModuleType rmt, NamedValueSet& parameters, bo
     // Initialise paramters
     initialise (fs);
     
-    // Initialise states and connection division term of the system
-    if (!initialiseModule())
-        sendChangeMessage();
+    // Initialise states and connection division term of the system (the instrument checks ableToInitialise after construction)
+    initialiseModule();
 
     if (Global::bowAtStartup)
     {
@@ -131,50 +132,181 @@ void StiffString::initialise (int fs)
 }
 
 void StiffString::refreshCoefficients()
+{
+    Coefficients c = getCoefficients();
+    calculateCoefficients (c);
+    setCoefficients (c);
+}
+
+StiffString::Coefficients StiffString::getCoefficients()
+{
+    Coefficients c;
+    c.L = L;
+    c.rho = rho;
+    c.A = A;
+    c.T = T;
+    c.E = E;
+    c.I = I;
+    c.sig0 = sig0;
+    c.sig1 = sig1;
+    
+    c.N = N;
+    c.cSq = cSq;
+    c.kappaSq = kappaSq;
+    c.lambdaSq = lambdaSq;
+    c.muSq = muSq;
+    c.h = h;
+    
+    c.Adiv = Adiv;
+    c.B0 = B0;
+    c.B1 = B1;
+    c.B2 = B2;
+    c.C0 = C0;
+    c.C1 = C1;
+    c.S0 = S0;
+    c.S1 = S1;
+    c.Bss = Bss;
+    c.connDivTerm = getConnectionDivisionTerm();
+    return c;
+}
+
+void StiffString::calculateCoefficients (Coefficients& c)
+{
+    c.h = getMinimumGridSpacing (c);
+    c.N = floor (c.L / c.h);
+    c.h = c.L / c.N; // recalculate h
+    
+    calculateSchemeCoefficients (c);
+}
+
+bool StiffString::calculateCoefficientsAtFixedGrid (Coefficients& c)
+{
+    if (c.h < getMinimumGridSpacing (c))
+        return false;
+    
+    calculateSchemeCoefficients (c);
+    return true;
+}
+
+double StiffString::getMinimumGridSpacing (Coefficients& c)
 {
     // Calculate wave speed (squared)
-    cSq = T / (rho * A);
+    c.cSq = c.T / (c.rho * c.A);
     
     // Calculate stiffness coefficient (squared)
-    kappaSq = E * I / (rho * A);
-    
-    double stabilityTerm = cSq * k * k + 4.0 * sig1 * k; // just easier to write down below
+    c.kappaSq = c.E * c.I / (c.rho * c.A);
     
-    h = sqrt (0.5 * (stabilityTerm + sqrt ((stabilityTerm * stabilityTerm) + 16.0 * kappaSq * k * k)));
-    N = floor (L / h);
-    h = L / N; // recalculate h
+    double stabilityTerm = c.cSq * k * k + 4.0 * c.sig1 * k; // just easier to write down below
     
-    lambdaSq = cSq * k * k / (h * h);
-    muSq = kappaSq * k * k / (h * h * h * h);
+    return sqrt (0.5 * (stabilityTerm + sqrt ((stabilityTerm * stabilityTerm) + 16.0 * c.kappaSq * k * k)));
+}
+
+void StiffString::calculateSchemeCoefficients (Coefficients& c)
+{
+    c.lambdaSq = c.cSq * k * k / (c.h * c.h);
+    c.muSq = c.kappaSq * k * k / (c.h * c.h * c.h * c.h);
     
     // Coefficients used for damping
-    S0 = sig0 * k;
-    S1 = (2.0 * sig1 * k) / (h * h);
+    c.S0 = c.sig0 * k;
+    c.S1 = (2.0 * c.sig1 * k) / (c.h * c.h);
     
     // Scheme coefficients
-    B0 = 2.0 - 2.0 * lambdaSq - 6.0 * muSq - 2.0 * S1; // u_l^n
-    B1 = lambdaSq + 4.0 * muSq + S1;                   // u_{l+-1}^n
-    B2 = -muSq;                                        // u_{l+-2}^n
-    C0 = -1.0 + S0 + 2.0 * S1;                         // u_l^{n-1}
-    C1 = -S1;                                          // u_{l+-1}^{n-1}
+    c.B0 = 2.0 - 2.0 * c.lambdaSq - 6.0 * c.muSq - 2.0 * c.S1; // u_l^n
+    c.B1 = c.lambdaSq + 4.0 * c.muSq + c.S1;                     // u_{l+-1}^n
+    c.B2 = -c.muSq;                                              // u_{l+-2}^n
+    c.C0 = -1.0 + c.S0 + 2.0 * c.S1;                             // u_l^{n-1}
+    c.C1 = -c.S1;                                                // u_{l+-1}^{n-1}
     
-    Bss = 2.0 - 2.0 * lambdaSq - 5.0 * muSq - 2.0 * S1; // u_l^n Simply supported
+    c.Bss = 2.0 - 2.0 * c.lambdaSq - 5.0 * c.muSq - 2.0 * c.S1; // u_l^n Simply supported
 
-    Adiv = 1.0 / (1.0 + S0);                           // u_l^{n+1}
+    c.Adiv = 1.0 / (1.0 + c.S0);                                // u_l^{n+1}
     
     // Divide by u_l^{n+1} term
-    B0 *= Adiv;
-    B1 *= Adiv;
-    B2 *= Adiv;
-    Bss *= Adiv;
-    C0 *= Adiv;
-    C1 *= Adiv;
+    c.B0 *= c.Adiv;
+    c.B1 *= c.Adiv;
+    c.B2 *= c.Adiv;
+    c.Bss *= c.Adiv;
+    c.C0 *= c.Adiv;
+    c.C1 *= c.Adiv;
+
+    c.connDivTerm = k * k / (c.rho * c.A * c.h * (1.0 + c.sig0 * k));
+}
+
+void StiffString::setCoefficients (Coefficients& c)
+{
+    L = c.L;
+    rho = c.rho;
+    A = c.A;
+    T = c.T;
+    E = c.E;
+    I = c.I;
+    sig0 = c.sig0;
+    sig1 = c.sig1;
+    
+    N = c.N;
+    cSq = c.cSq;
+    kappaSq = c.kappaSq;
+    lambdaSq = c.lambdaSq;
+    muSq = c.muSq;
+    h = c.h;
+    
+    Adiv = c.Adiv;
+    B0 = c.B0;
+    B1 = c.B1;
+    B2 = c.B2;
+    C0 = c.C0;
+    C1 = c.C1;
+    S0 = c.S0;
+    S1 = c.S1;
+    Bss = c.Bss;
+    
+    stencil.B0 = B0;
+    stencil.B1 = B1;
+    stencil.B2 = B2;
+    stencil.C0 = C0;
+    stencil.C1 = C1;
+    stencil.Bss = Bss;
+    
+    setConnectionDivisionTerm (c.connDivTerm);
+}
 
-    setConnectionDivisionTerm (k * k / (rho * A * h * (1.0 + sig0 * k)));
+bool StiffString::calculatePendingCoefficients (NamedValueSet& newParameters)
+{
+    pendingCoefficients = getCoefficients();
+    pendingCoefficients.L = *newParameters.getVarPointer ("L");
+    pendingCoefficients.rho = *newParameters.getVarPointer ("rho");
+    pendingCoefficients.A = *newParameters.getVarPointer ("A");
+    if (newParameters.contains ("T"))
+        pendingCoefficients.T = *newParameters.getVarPointer ("T");
+    pendingCoefficients.E = *newParameters.getVarPointer ("E");
+    pendingCoefficients.I = *newParameters.getVarPointer ("I");
+    pendingCoefficients.sig0 = *newParameters.getVarPointer ("sig0");
+    pendingCoefficients.sig1 = *newParameters.getVarPointer ("sig1");
+
+    calculateCoefficients (pendingCoefficients);
+    pendingN = pendingCoefficients.N;
+    
+    return true;
+}
+
+bool StiffString::refreshCoefficientsAtFixedGrid (double TToSet, double rhoToSet, double sig0ToSet, double sig1ToSet)
+{
+    Coefficients c = getCoefficients();
+    c.T = TToSet;
+    c.rho = rhoToSet;
+    c.sig0 = sig0ToSet;
+    c.sig1 = sig1ToSet;
+    
+    if (!calculateCoefficientsAtFixedGrid (c))
+        return false;
+    
+    setCoefficients (c);
+    return true;
 }
 
 void StiffString::paint (juce::Graphics& g)
 {
+    TraceCapture::Scope traceScope ("paint1D");
     // Draw the state
     switch (getResonatorModuleType()) {
         case stiffString:
@@ -225,38 +357,59 @@ void StiffString::paint (juce::Graphics& g)
     }
 }
 
-Path StiffString::visualiseState (Graphics& g)
+const Path& StiffString::visualiseState (Graphics& g)
 {
     // String-boundaries are in the vertical middle of the component
     double stringBoundaries = getHeight() / 2.0;
     
-    // Initialise path
-    Path stringPath;
+    // Clear the path (keeps its storage)
+    statePath.clear();
+    
+    // Only read from the snapshot published by the audio thread
+    const VisualSnapshot::Frame& frame = getVisualFrame();
+    if (!frame.hasData())
+        return statePath;
+    
+    // Needs to be -u, because a positive u would visually go down
+    auto getY = [&] (double val) {
+        float y = -val * visualScaling * getHeight() + stringBoundaries;
+        // if we get NAN values, make sure that we don't get an exception
+        return std::isnan (y) ? 0.0f : y;
+    };
+    
+    if (frame.minMax)
+    {
+        // one vertical line from min to max per pixel column
+        statePath.startNewSubPath (0, getY (frame.values[0]));
+        statePath.lineTo (0, getY (frame.values[1]));
+        for (int i = 1; i < frame.width; ++i)
+        {
+            float x = i * getWidth() / static_cast<float> (frame.width - 1);
+            statePath.lineTo (x, getY (frame.values[2 * i]));
+            statePath.lineTo (x, getY (frame.values[2 * i + 1]));
+        }
+        return statePath;
+    }
     
     // Start path
-    stringPath.startNewSubPath (0, -u[1][0] * visualScaling * getHeight() + stringBoundaries);
+    statePath.startNewSubPath (0, getY (frame.values[0]));
     
-    double spacing = getWidth() / static_cast<double>(N);
+    double spacing = getWidth() / static_cast<double>(frame.width - 1);
     double x = spacing;
     
-    for (int l = 1; l <= N; l++)
+    for (int l = 1; l < frame.width; l++)
     {
-        // Needs to be -u, because a positive u would visually go down
-        float newY = -u[1][l] * visualScaling * getHeight() + stringBoundaries;
-        
-        // if we get NAN values, make sure that we don't get an exception
-        if (std::isnan(newY))
-            newY = 0;
-        
-        stringPath.lineTo (x, newY);
+        statePath.lineTo (x, getY (frame.values[l]));
         x += spacing;
     }
     
-    return stringPath;
+    return statePath;
 }
 
 void StiffString::resized()
 {
+    setVisualSize (getWidth(), getHeight());
+
 //    if (getExciterModule()->getExciterModuleType() == pluck)
 //        exciterModule->setResHeight (getHeight());
 
@@ -264,18 +417,7 @@ void StiffString::resized()
 
 void StiffString::calculate()
 {
-    for (int l = 2; l < N-1; ++l) // clamped boundaries
-    {
-        u[0][l] = B0 * u[1][l] + B1 * (u[1][l + 1] + u[1][l - 1]) + B2 * (u[1][l + 2] + u[1][l - 2])
-                + C0 * u[2][l] + C1 * (u[2][l + 1] + u[2][l - 1]);
-    }
-    
-    // simply supported boundary conditions
-    if (bc == simplySupportedBC)
-    {
-        u[0][1] = Bss * u[1][1] + B1 * u[1][2] + B2 * u[1][3] + C0 * u[2][1] + C1 * u[2][2];
-        u[0][N-1] = Bss * u[1][N-1] + B1 * u[1][N-2] + B2 * u[1][N-3] + C0 * u[2][N-1] + C1 * u[2][N-2];
-    }
+    kernel (u, N, stencil);
 
 //    if (getExcitationType() == bow)
 //    {
@@ -287,6 +429,21 @@ void StiffString::calculate()
     ++calcCounter;
 }
 
+#ifdef KERNEL_EQUIVALENCE_CHECK
+void StiffString::calculateReference()
+{
+    for (int l = 2; l < N-1; ++l)
+        u[0][l] = B0 * u[1][l] + B1 * (u[1][l + 1] + u[1][l - 1]) + B2 * (u[1][l + 2] + u[1][l - 2])
+                + C0 * u[2][l] + C1 * (u[2][l + 1] + u[2][l - 1]);
+    
+    if (bc == simplySupportedBC)
+    {
+        u[0][1] = Bss * u[1][1] + B1 * u[1][2] + B2 * u[1][3] + C0 * u[2][1] + C1 * u[2][2];
+        u[0][N-1] = Bss * u[1][N-1] + B1 * u[1][N-2] + B2 * u[1][N-3] + C0 * u[2][N-1] + C1 * u[2][N-2];
+    }
+}
+#endif
+
 float StiffString::getOutput (int idx)
 {
 //    return Global::oneDOutputScaling * u[1][static_cast<int>(Global::limit (idx, (bc == clampedBC) ? 2 : 1, (bc == clampedBC) ? N-2 : N-1))];
@@ -349,8 +506,6 @@ void StiffString::myMouseEnter (const double x, const double y, bool triggeredBy
     if (getExcitationType() == noExcitation)
         return;
     
-    getCurExciterModule()->startTimer (1.0 / 150.0);
-
     //    prevYLoc = e.y;
     switch (getExcitationType()) {
         case pluck:
@@ -378,7 +533,6 @@ void StiffString::myMouseExit (const double x, const double y, bool triggeredByM
     if (getCurExciterModule() == nullptr)
         return;
     
-    getCurExciterModule()->stopTimer();
     getCurExciterModule()->mouseExited();
 
     switch (getExcitationType()) {
@@ -509,36 +663,40 @@ double StiffString::getInputEnergy()
     return 0;
 }
 
-void StiffString::initialiseExciterModule (std::shared_ptr<ExciterModule> exciterModule)
+void StiffString::fillExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator)
 {
-    
-    NamedValueSet parametersFromResonator;
-    switch (exciterModule->getExcitationType())
+    Coefficients c = getCoefficients();
+    fillExciterParameters (e, c, parametersFromResonator);
+}
+
+void StiffString::fillExciterParameters (ExcitationType e, Coefficients& c, NamedValueSet& parametersFromResonator)
+{
+    switch (e)
     {
         case pluck:
         case hammer:
-            parametersFromResonator.set ("h", h);
+            parametersFromResonator.set ("h", c.h);
             parametersFromResonator.set ("k", k);
-            parametersFromResonator.set ("rho", rho);
-            parametersFromResonator.set ("A", A);
-            parametersFromResonator.set ("sig0", sig0);
-            parametersFromResonator.set ("connDivTerm", getConnectionDivisionTerm());
-            parametersFromResonator.set ("resHeight", getHeight());
+            parametersFromResonator.set ("rho", c.rho);
+            parametersFromResonator.set ("A", c.A);
+            parametersFromResonator.set ("sig0", c.sig0);
+            parametersFromResonator.set ("connDivTerm", c.connDivTerm);
+            parametersFromResonator.set ("resHeight", getResonatorHeight());
             break;
         case bow:
-            parametersFromResonator.set ("cSq", cSq);
-            parametersFromResonator.set ("kappaSq", kappaSq);
-            parametersFromResonator.set ("h", h);
+            parametersFromResonator.set ("cSq", c.cSq);
+            parametersFromResonator.set ("kappaSq", c.kappaSq);
+            parametersFromResonator.set ("h", c.h);
             parametersFromResonator.set ("k", k);
-            parametersFromResonator.set ("rho", rho);
-            parametersFromResonator.set ("A", A);
-            parametersFromResonator.set ("sig0", sig0);
-            parametersFromResonator.set ("sig1", sig1);
-            parametersFromResonator.set ("connDivTerm", getConnectionDivisionTerm());
+            parametersFromResonator.set ("rho", c.rho);
+            parametersFromResonator.set ("A", c.A);
+            parametersFromResonator.set ("sig0", c.sig0);
+            parametersFromResonator.set ("sig1", c.sig1);
+            parametersFromResonator.set ("connDivTerm", c.connDivTerm);
+            break;
+        default:
             break;
-            
     }
-    exciterModule->initialise (parametersFromResonator);
 }
 
 void StiffString::saveOutput()
@@ -560,14 +718,38 @@ void StiffString::saveOutput()
 
 void StiffString::changeDensity (double rhoToSet)
 {
-    T = T * rhoToSet / rho;
-    E = E * rhoToSet / rho;
-    rho = rhoToSet;
+    // The members are only changed once the regrid is applied on the audio thread
+    // Use the parameters of the module rather than the members, as the latter might be modulated
     NamedValueSet p = getParameters();
-    p.set ("rho", rho);
-    p.set ("T", T);
-    p.set ("E", E);
+    double ratio = rhoToSet / static_cast<double> (*p.getVarPointer ("rho"));
+    p.set ("rho", rhoToSet);
+    if (p.contains ("T"))
+        p.set ("T", static_cast<double> (*p.getVarPointer ("T")) * ratio);
+    p.set ("E", static_cast<double> (*p.getVarPointer ("E")) * ratio);
     setParameters (p);
     
-    refreshCoefficients();
+    requestRegrid (p);
+}
+
+void StiffString::changeTension (double TToSet)
+{
+    NamedValueSet p = getParameters();
+    if (!p.contains ("T"))
+    {
+        DBG ("A bar does not have a tension");
+        return;
+    }
+    p.set ("T", TToSet);
+    setParameters (p);
+    
+    requestRegrid (p);
+}
+
+void StiffString::changeDimensions (double LxToSet, double LyToSet)
+{
+    NamedValueSet p = getParameters();
+    p.set ("L", LxToSet);
+    setParameters (p);
+    
+    requestRegrid (p);
 }
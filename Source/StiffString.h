@@ -13,13 +13,14 @@
 #include <JuceHeader.h>
 #include "Global.h"
 #include "ResonatorModule.h"
+#include "StencilKernels.h"
 //==============================================================================
 /*
 */
 class StiffString  : public ResonatorModule
 {
 public:
-    StiffString (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = simplySupportedBC);
+    StiffString (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo = InOutInfo(), BoundaryCondition bc = simplySupportedBC);
     ~StiffString() override;
 
     // initialisation
@@ -30,9 +31,12 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
 
-    Path visualiseState (Graphics& g);
+    const Path& visualiseState (Graphics& g); // reuses statePath
 
     void calculate() override;
+#ifdef KERNEL_EQUIVALENCE_CHECK
+    void calculateReference() override;
+#endif
     void exciteRaisedCos() override;
 
     float getOutput (int idx) override;
@@ -59,13 +63,45 @@ public:
     double getInputEnergy() override;
     
     double getMassPerGridPoint() override { return rho * A * h; };
-    void initialiseExciterModule (std::shared_ptr<ExciterModule> exciterModule) override;
     
     void saveOutput() override;
     
     void changeDensity (double rhoToSet) override;
+    void changeTension (double TToSet) override;
+    void changeDimensions (double LxToSet, double LyToSet) override;
+    
+    // Model parameters and everything that follows from them. Can be calculated off the audio thread (used for regridding)
+    struct Coefficients
+    {
+        // model parameters
+        double L, rho, A, T, E, I, sig0, sig1;
+        
+        // grid and scheme variables
+        int N;
+        double cSq, kappaSq, lambdaSq, muSq, h;
+        double Adiv, B0, B1, B2, C0, C1, S0, S1, Bss;
+        double connDivTerm;
+    };
+    
+    Coefficients getCoefficients();
+    void calculateCoefficients (Coefficients& c); // calculates everything from the model parameters in c
+    bool calculateCoefficientsAtFixedGrid (Coefficients& c); // same, but keeps N and h. Returns false if h does not satisfy the stability condition
+    void setCoefficients (Coefficients& c);
+
+protected:
+    bool calculatePendingCoefficients (NamedValueSet& newParameters) override;
+    void applyPendingCoefficients() override { setCoefficients (pendingCoefficients); };
+    
+    void fillExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) override;
+    void fillPendingExciterParameters (ExcitationType e, NamedValueSet& parametersFromResonator) override { fillExciterParameters (e, pendingCoefficients, parametersFromResonator); };
+    
+    bool refreshCoefficientsAtFixedGrid (double TToSet, double rhoToSet, double sig0ToSet, double sig1ToSet) override;
 
 private:
+    double getMinimumGridSpacing (Coefficients& c); // also sets cSq and kappaSq
+    void calculateSchemeCoefficients (Coefficients& c); // uses the grid spacing in c
+    void fillExciterParameters (ExcitationType e, Coefficients& c, NamedValueSet& parametersFromResonator);
+    
     
     // Model parameters
     double L, rho, A, T, E, I, cSq, kappaSq, sig0, sig1, lambdaSq, muSq, h, k;
@@ -77,7 +113,15 @@ private:
         - S for precalculated sigma terms
     */
     double Adiv, B0, B1, B2, C0, C1, S0, S1, Bss;
+    
+    // kernel for the boundary condition (selected at construction) and the scheme variables it uses. Kept on their own cache line (see the simulation core of ResonatorModule)
+    alignas (64) StencilKernels::Kernel1D kernel;
+    StencilKernels::Coefficients stencil;
+    
+    Coefficients pendingCoefficients;
 
+    Path statePath; // kept to reuse its storage
+    
     double prevLoc = 0;
     float excitationLoc = 0.5;
     float yLoc = 0;
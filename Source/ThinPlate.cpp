@@ -12,7 +12,7 @@
 #include "ThinPlate.h"
 
 //==============================================================================
-ThinPlate::ThinPlate (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, InOutInfo inOutInfo, BoundaryCondition bc) : StiffMembrane (rmt, parameters, advanced, fs, ID, instrument, inOutInfo, bc)
+ThinPlate::ThinPlate (ResonatorModuleType rmt, NamedValueSet& parameters, bool advanced, int fs, int ID, ChangeListener* instrument, ProcessingMode processingMode, InOutInfo inOutInfo, BoundaryCondition bc) : StiffMembrane (rmt, parameters, advanced, fs, ID, instrument, processingMode, inOutInfo, bc)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
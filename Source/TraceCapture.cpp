@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    TraceCapture.cpp
+    Created: 19 Oct 2026 8:36:10pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "TraceCapture.h"
+
+std::atomic<TraceCapture*> TraceCapture::instance { nullptr };
+
+TraceCapture::TraceCapture()
+{
+    instance = this;
+}
+
+TraceCapture::~TraceCapture()
+{
+    capturing = false;
+    instance = nullptr;
+    while (numWriters.load() > 0)
+        Thread::yield();
+}
+
+void TraceCapture::start()
+{
+    if (capturing)
+        return;
+    
+    if (events.size() == 0)
+        events.resize (Global::traceCaptureSize);
+    
+    numEvents = 0;
+    numDroppedEvents = 0;
+    startTicks = Time::getHighResolutionTicks();
+    capturing = true;
+}
+
+bool TraceCapture::stop (const File& file)
+{
+    if (!capturing)
+        return false;
+    capturing = false;
+    
+    // threads that started adding an event before the capture stopped (the others see that it stopped)
+    while (numWriters.load() > 0)
+        Thread::yield();
+    
+    int n = numEvents.load();
+    if (numDroppedEvents.load() > 0)
+        DBG ("Trace capture buffer was full: " + String (numDroppedEvents.load()) + " events were dropped");
+    
+    file.deleteFile();
+    FileOutputStream stream (file);
+    if (stream.failedToOpen())
+        return false;
+    
+    const double microsecondsPerTick = 1e6 / static_cast<double> (Time::getHighResolutionTicksPerSecond());
+    stream << "{\"traceEvents\":[\n";
+    for (int i = 0; i < n; ++i)
+    {
+        const Event& e = events[i];
+        stream << "{\"name\":\"" << e.name << "\",\"ph\":\"" << String::charToString (e.phase)
+               << "\",\"ts\":" << String ((e.ticks - startTicks) * microsecondsPerTick, 3)
+               << ",\"pid\":1,\"tid\":" << String (static_cast<int64> (e.threadId));
+        if (e.phase == 'C')
+            stream << ",\"args\":{\"value\":" << String (e.value) << "}";
+        stream << (i == n - 1 ? "}\n" : "},\n");
+    }
+    stream << "]}\n";
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+void TraceCapture::addEvent (const char* name, char phase, double value)
+{
+    // registered before checking again, so stop() either waits for this event or this event sees that the capture stopped
+    ++numWriters;
+    if (!capturing.load())
+    {
+        --numWriters;
+        return;
+    }
+    
+    // the count saturates at the size of the buffer
+    const int capacity = static_cast<int> (events.size());
+    int idx = numEvents.load (std::memory_order_relaxed);
+    do
+    {
+        if (idx >= capacity)
+        {
+            ++numDroppedEvents;
+            --numWriters;
+            return;
+        }
+    }
+    while (!numEvents.compare_exchange_weak (idx, idx + 1, std::memory_order_relaxed));
+    
+    events[idx] = { name, Time::getHighResolutionTicks(), reinterpret_cast<pointer_sized_int> (Thread::getCurrentThreadId()), value, phase };
+    --numWriters;
+}
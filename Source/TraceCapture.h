@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    TraceCapture.h
+    Created: 19 Oct 2026 8:36:10pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+/*  Records timestamped begin / end events (and counters) from any thread into a preallocated buffer and writes them as a Chrome trace-event JSON file (open it in chrome://tracing or Perfetto).
+ 
+    When no capture is running, every call is two relaxed atomic loads. Event names must be string literals (only the pointer is stored). Keep an instance alive (e.g. a SharedResourcePointer in the processor) to be able to capture.
+ */
+class TraceCapture
+{
+public:
+    TraceCapture();
+    ~TraceCapture();
+    
+    // Message thread
+    void start();
+    bool stop (const File& file); // writes the captured events to file
+    bool isCapturing() { return capturing.load(); };
+    
+    // Any thread
+    static bool isActive() { return getActiveInstance() != nullptr; };
+    static void begin (const char* name) { if (TraceCapture* t = getActiveInstance()) t->addEvent (name, 'B', 0.0); };
+    static void end (const char* name) { if (TraceCapture* t = getActiveInstance()) t->addEvent (name, 'E', 0.0); };
+    static void counter (const char* name, double value) { if (TraceCapture* t = getActiveInstance()) t->addEvent (name, 'C', value); };
+    
+    // Adds a begin event on construction and an end event on destruction
+    class Scope
+    {
+    public:
+        Scope (const char* nameToUse) : name (nameToUse) { begin (name); };
+        ~Scope() { end (name); };
+    private:
+        const char* name;
+    };
+    
+private:
+    struct Event
+    {
+        const char* name;
+        int64 ticks;
+        pointer_sized_int threadId;
+        double value;
+        char phase;
+    };
+    
+    // the instance is only loaded once, so that it can not change between the check and the use
+    static TraceCapture* getActiveInstance()
+    {
+        TraceCapture* t = instance.load (std::memory_order_relaxed);
+        return (t != nullptr && t->capturing.load (std::memory_order_relaxed)) ? t : nullptr;
+    };
+    
+    void addEvent (const char* name, char phase, double value);
+    
+    static std::atomic<TraceCapture*> instance;
+    
+    std::vector<Event> events; // allocated by the first capture
+    std::atomic<int> numEvents { 0 }; // never exceeds the size of events
+    std::atomic<int64> numDroppedEvents { 0 };
+    std::atomic<int> numWriters { 0 }; // threads that are adding an event (stop waits for them)
+    std::atomic<bool> capturing { false };
+    int64 startTicks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceCapture)
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    VisualSnapshot.h
+    Created: 19 Oct 2026 4:52:30pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+/*  Triple buffer to pass the (decimated) state of a resonator module from the audio thread to the editor without locking. The audio thread writes into its own frame and publishes it, the editor picks up the latest published frame. Neither thread ever waits for the other and all frames are allocated up front.
+ */
+class VisualSnapshot
+{
+public:
+    struct Frame
+    {
+        std::vector<double> values;
+        int width = 0;  // number of values (1D) or number of columns (2D)
+        int height = 1; // number of rows (2D)
+        bool minMax = false; // (1D only) values contains a min/max pair per column
+        bool hasData() const { return width > 0; };
+        int getNumValues() const { return width * height * (minMax ? 2 : 1); };
+    };
+
+    VisualSnapshot (int capacityToSet)
+    {
+        capacity = capacityToSet;
+        for (auto& frame : frames)
+            frame.values.resize (capacity, 0.0);
+    };
+    ~VisualSnapshot() {};
+
+    int getCapacity() { return capacity; };
+
+    // Audio thread
+    Frame& getWriteFrame() { return frames[writeIdx]; };
+    void publish() { writeIdx = middleIdx.exchange (writeIdx | newDataFlag) & indexMask; };
+
+    // Message thread. Picks up the latest published frame (if there is one) and returns it.
+    const Frame& getReadFrame()
+    {
+        if (middleIdx.load() & newDataFlag)
+            readIdx = middleIdx.exchange (readIdx) & indexMask;
+        return frames[readIdx];
+    };
+
+private:
+    static const int newDataFlag = 4;
+    static const int indexMask = 3;
+
+    Frame frames[3];
+    int capacity;
+
+    int writeIdx = 0;               // only used by the audio thread
+    std::atomic<int> middleIdx { 1 };
+    int readIdx = 2;                // only used by the message thread
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VisualSnapshot)
+};
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    WorkerPool.cpp
+    Created: 20 Oct 2026 12:24:51am
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool (int numThreads)
+{
+    for (int i = 0; i < numThreads; ++i)
+    {
+        workers.add (new Worker (*this));
+#if (JUCE_VERSION < 0x070003) // Thread::Priority was added in JUCE 7.0.3
+        workers.getLast()->startThread (9);
+#else
+        workers.getLast()->startThread (Thread::Priority::highest);
+#endif
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    for (auto worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+    for (auto worker : workers)
+        worker->stopThread (1000);
+}
+
+void WorkerPool::run (Job& job, int numTasks)
+{
+    if (numTasks <= 0)
+        return;
+    
+    // without workers (or with a single task) there is nothing to hand out
+    if (workers.size() == 0 || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            job.runTask (i);
+        return;
+    }
+    
+    numTasksDone.store (0);
+    currentJob.store (&job);
+    taskState.store (static_cast<int64> (numTasks) << 32);
+    
+    // the workers that are still spinning pick the tasks up by themselves
+    for (int i = 0; i < jmin (workers.size(), numTasks - 1); ++i)
+        if (workers[i]->blocked.load())
+            workers[i]->notify();
+    
+    // help out instead of waiting
+    while (runNextTask()) {}
+    
+    // wait for the tasks that are still running on the workers
+    while (numTasksDone.load() < numTasks)
+        std::this_thread::yield();
+}
+
+bool WorkerPool::hasTasksLeft()
+{
+    int64 state = taskState.load();
+    return static_cast<int> (state & 0xffffffff) < static_cast<int> (state >> 32);
+}
+
+bool WorkerPool::runNextTask()
+{
+    int64 state = taskState.load();
+    while (true)
+    {
+        int numTasks = static_cast<int> (state >> 32);
+        int taskIdx = static_cast<int> (state & 0xffffffff);
+        if (taskIdx >= numTasks)
+            return false;
+        
+        // a successful exchange means that the task belongs to the current job (the job cannot change before it is done)
+        if (taskState.compare_exchange_weak (state, state + 1))
+        {
+            currentJob.load()->runTask (taskIdx);
+            numTasksDone.fetch_add (1);
+            return true;
+        }
+    }
+}
+
+void WorkerPool::Worker::run()
+{
+    const int64 spinTicks = Time::secondsToHighResolutionTicks (Global::workerSpinTime);
+    while (!threadShouldExit())
+    {
+        while (pool.runNextTask()) {}
+        
+        // spin for a while, as the next job usually follows soon
+        const int64 spinStart = Time::getHighResolutionTicks();
+        while (!pool.hasTasksLeft() && !threadShouldExit() && Time::getHighResolutionTicks() - spinStart < spinTicks)
+            std::this_thread::yield();
+        if (pool.hasTasksLeft())
+            continue;
+        
+        // block. The tasks are checked again after setting the flag, as run() may have published them just before (it only wakes blocked workers)
+        blocked.store (true);
+        if (!pool.hasTasksLeft())
+            wait (-1);
+        blocked.store (false);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+    Created: 20 Oct 2026 12:24:51am
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Global.h"
+
+/*  Small pool of worker threads for splitting the work of a block into independent tasks (audio thread).
+ 
+    run() hands the tasks of a job out to the workers and to the calling thread, and returns once all tasks are done. It does not allocate. Only one thread should call run() at a time.
+ 
+    Jobs can follow each other within microseconds (the band decomposition dispatches one every sample), so a worker spins for Global::workerSpinTime after its last task before it blocks. Only blocked workers are woken, which is not lock-free: it signals their WaitableEvent, which takes the (uncontended) mutex of that event.
+ */
+class WorkerPool
+{
+public:
+    struct Job
+    {
+        virtual ~Job() {};
+        virtual void runTask (int taskIdx) = 0;
+    };
+    
+    WorkerPool (int numThreads);
+    ~WorkerPool();
+    
+    int getNumThreads() { return workers.size(); };
+    
+    void run (Job& job, int numTasks);
+    
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker (WorkerPool& pool) : Thread ("ModularVST worker"), pool (pool) {};
+        void run() override;
+        
+        std::atomic<bool> blocked { false }; // set before the worker blocks, so that run() knows it needs to wake it
+        
+    private:
+        WorkerPool& pool;
+    };
+    
+    // Claims and runs the next task of the current job. Returns false if there are none left.
+    bool runNextTask();
+    bool hasTasksLeft();
+    
+    OwnedArray<Worker> workers;
+    
+    std::atomic<Job*> currentJob { nullptr };
+    std::atomic<int64> taskState { 0 }; // number of tasks (high 32 bits) and index of the next task (low 32 bits)
+    std::atomic<int> numTasksDone { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
@@ -0,0 +1,286 @@
+/*
+  ==============================================================================
+
+    KernelEquivalenceCheck.cpp
+    Created: 19 Oct 2026 9:52:03pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "KernelEquivalenceCheck.h"
+
+static KernelEquivalenceCheck kernelEquivalenceCheck;
+
+void KernelEquivalenceCheck::runTest()
+{
+    instrument = std::make_unique<Instrument> (fs);
+    
+    // 2D modules only implement clamped boundary conditions
+    std::vector<std::pair<ResonatorModuleType, BoundaryCondition>> moduleTypes {
+        {stiffString, clampedBC},
+        {stiffString, simplySupportedBC},
+        {bar, clampedBC},
+        {bar, simplySupportedBC},
+        {membrane, clampedBC},
+        {thinPlate, clampedBC},
+        {stiffMembrane, clampedBC}
+    };
+    
+    for (auto& moduleType : moduleTypes)
+    {
+        beginTest (getTypeString (moduleType.first, moduleType.second));
+        int numPassed = 0;
+        int numFailed = 0;
+        int numSkipped = 0;
+        for (int c = 0; c < Global::kernelCheckNumCases; ++c)
+        {
+            switch (runCase (moduleType.first, moduleType.second))
+            {
+                case casePassed:
+                    ++numPassed;
+                    break;
+                case caseFailed:
+                    ++numFailed;
+                    break;
+                case caseSkipped:
+                    ++numSkipped;
+                    break;
+            }
+        }
+        logMessage (String (numPassed) + " passed, " + String (numFailed) + " failed, " + String (numSkipped) + " skipped (invalid grid)");
+        expect (numPassed + numFailed > 0, "All cases were skipped");
+    }
+    
+    std::vector<ConnectionType> connectionTypes {rigid, linearSpring, nonlinearSpring};
+    for (auto connectionType : connectionTypes)
+    {
+        beginTest ("Connection solver: " + getConnectionTypeString (connectionType));
+        runConnectionCase (connectionType, stiffString);
+        runConnectionCase (connectionType, thinPlate);
+    }
+    
+    instrument.reset();
+}
+
+KernelEquivalenceCheck::CaseResult KernelEquivalenceCheck::runCase (ResonatorModuleType rmt, BoundaryCondition bc)
+{
+    // scale every parameter by a random factor between 0.5 and 2
+    NamedValueSet parameters = Global::getDefaultParametersAdvanced (rmt);
+    Global::randomiseParameters (parameters, random, 2.0);
+    std::shared_ptr<ResonatorModule> variant = createModule (rmt, parameters, bc);
+    std::shared_ptr<ResonatorModule> reference = createModule (rmt, parameters, bc);
+    std::shared_ptr<ResonatorModule> stepReference = createModule (rmt, parameters, bc);
+    
+    if (!variant->isModuleReady() || !reference->isModuleReady() || !stepReference->isModuleReady())
+        return caseSkipped;
+    
+    String line = variant->isModule1D() ? String (variant->getNumIntervals()) + " intervals: " : String (variant->getNumPoints()) + " points: ";
+    
+    // random initial state (the same for all three)
+    std::vector<std::vector<double>> states (variant->getNumStateVectors(), std::vector<double> (variant->getStateVectorSize(), 0.0));
+    for (auto& state : states)
+        for (auto& value : state)
+            value = (2.0 * random.nextDouble() - 1.0) * Global::kernelCheckInitAmplitude;
+    variant->setStatesFrom (states);
+    reference->setStatesFrom (states);
+    
+    std::vector<std::vector<double>> variantStates (states);
+    std::vector<std::vector<double>> stepReferenceStates (states);
+    
+    int64 maxUlps = 0;
+    for (int n = 0; n < Global::kernelCheckNumSteps; ++n)
+    {
+        // after the single steps only the long run continues
+        if (n >= Global::kernelCheckNumSingleSteps)
+        {
+            variant->calculate();
+            reference->calculateReference();
+            variant->update();
+            reference->update();
+            continue;
+        }
+        
+        variant->copyStatesTo (variantStates);
+        stepReference->setStatesFrom (variantStates);
+        
+        variant->calculate();
+        stepReference->calculateReference();
+        reference->calculateReference();
+        
+        // compare the newly calculated states
+        variant->copyStatesTo (variantStates);
+        stepReference->copyStatesTo (stepReferenceStates);
+        for (size_t i = 0; i < variantStates[0].size(); ++i)
+            maxUlps = std::max (maxUlps, getUlpDistance (variantStates[0][i], stepReferenceStates[0][i]));
+        
+        variant->update();
+        reference->update();
+    }
+    
+    // divergence of the long run, relative to the largest value of the reference
+    std::vector<std::vector<double>> referenceStates (states);
+    variant->copyStatesTo (variantStates);
+    reference->copyStatesTo (referenceStates);
+    double maxDiff = 0.0;
+    double maxReference = 0.0;
+    for (size_t i = 0; i < referenceStates[1].size(); ++i)
+    {
+        maxDiff = std::max (maxDiff, std::abs (variantStates[1][i] - referenceStates[1][i]));
+        maxReference = std::max (maxReference, std::abs (referenceStates[1][i]));
+    }
+    double divergence = maxDiff / std::max (maxReference, std::numeric_limits<double>::min());
+    
+    expectLessOrEqual (maxUlps, Global::kernelCheckMaxUlps, line + "ULPs per step");
+    expectLessOrEqual (divergence, Global::kernelCheckMaxDivergence, line + "divergence after " + String (Global::kernelCheckNumSteps) + " steps");
+    
+    return (maxUlps <= Global::kernelCheckMaxUlps && divergence <= Global::kernelCheckMaxDivergence) ? casePassed : caseFailed;
+}
+
+void KernelEquivalenceCheck::runConnectionCase (ConnectionType connectionType, ResonatorModuleType rmt)
+{
+    Instrument connectionInstrument (fs);
+    InOutInfo inOutInfo (false);
+    NamedValueSet otherParameters = Global::getDefaultParametersAdvanced (rmt);
+    String line = "String to " + String (rmt == stiffString ? "string" : "plate") + ": ";
+    if (!connectionInstrument.addResonatorModule (stiffString, Global::defaultStringParametersAdvanced, inOutInfo, true)
+        || !connectionInstrument.addResonatorModule (rmt, otherParameters, inOutInfo, true))
+    {
+        expect (false, line + "invalid grid");
+        return;
+    }
+    
+    std::shared_ptr<ResonatorModule> string = connectionInstrument.getResonatorPtr (0);
+    std::shared_ptr<ResonatorModule> other = connectionInstrument.getResonatorPtr (1);
+    
+    // connect off-centre points (grid indices, away from the boundaries)
+    connectionInstrument.addFirstConnection (string, connectionType, static_cast<double> (string->getNumIntervals() / 3));
+    if (other->isModule1D())
+        connectionInstrument.addSecondConnection (other, static_cast<double> ((2 * other->getNumIntervals()) / 3));
+    else
+        connectionInstrument.addSecondConnection (other, static_cast<double> (other->getNumIntervalsX() / 3 + (other->getNumIntervalsY() / 3) * other->getNumIntervalsX()), 0.0);
+    connectionInstrument.setCurrentlyActiveConnection (nullptr);
+    connectionInstrument.setAction (noAction);
+    
+    string->triggerRaisedCos();
+    connectionInstrument.checkIfShouldExciteRaisedCos();
+    
+    Instrument::ConnectionInfo& connection = (*connectionInstrument.getConnectionInfo())[0];
+    double divTerm1 = connection.res1->getConnectionDivisionTerm();
+    double divTerm2 = connection.res2->getConnectionDivisionTerm();
+    
+    double maxForceError = 0.0;
+    double maxEquationError = 0.0;
+    double maxDisplacement = 0.0;
+    for (int n = 0; n < Global::connectionCheckNumSteps; ++n)
+    {
+        connectionInstrument.calculate();
+        double u1Before = connection.res1->getStateAt (connection.loc1, 0);
+        double u2Before = connection.res2->getStateAt (connection.loc2, 0);
+        double eta = connection.res1->getStateAt (connection.loc1, 1) - connection.res2->getStateAt (connection.loc2, 1);
+        double etaPrev = connection.res1->getStateAt (connection.loc1, 2) - connection.res2->getStateAt (connection.loc2, 2);
+        
+        connectionInstrument.solveInteractions();
+        double u1 = connection.res1->getStateAt (connection.loc1, 0);
+        double u2 = connection.res2->getStateAt (connection.loc2, 0);
+        
+        // the forces that were applied to both ends (addForce scales by the division term)
+        double force1 = -(u1 - u1Before) / divTerm1;
+        double force2 = (u2 - u2Before) / divTerm2;
+        double forceScale = std::max ({std::abs (force1), std::abs (force2), std::numeric_limits<double>::min()});
+        maxForceError = std::max (maxForceError, std::abs (force1 - force2) / forceScale);
+        
+        double etaNext = u1 - u2;
+        maxDisplacement = std::max ({maxDisplacement, std::abs (u1), std::abs (u2)});
+        if (connectionType == rigid)
+        {
+            maxEquationError = std::max (maxEquationError, std::abs (etaNext) / std::max (maxDisplacement, std::numeric_limits<double>::min()));
+        }
+        else
+        {
+            double rPlus = 0.5 * connection.K1 + 0.5 * connection.K3 * eta * eta + 0.5 * fs * connection.R;
+            double rMin = 0.5 * connection.K1 + 0.5 * connection.K3 * eta * eta - 0.5 * fs * connection.R;
+            double expectedForce = rPlus * etaNext + rMin * etaPrev;
+            maxEquationError = std::max (maxEquationError, std::abs (force2 - expectedForce) / std::max (forceScale, std::abs (expectedForce)));
+        }
+        
+        connectionInstrument.update();
+    }
+    
+    expect (maxDisplacement > 0.0, line + "the excitation did not reach the connection");
+    expectLessOrEqual (maxForceError, Global::connectionCheckMaxError, line + "forces on both ends");
+    expectLessOrEqual (maxEquationError, Global::connectionCheckMaxError, line + "connection equation");
+}
+
+std::shared_ptr<ResonatorModule> KernelEquivalenceCheck::createModule (ResonatorModuleType rmt, NamedValueSet parameters, BoundaryCondition bc)
+{
+    // the modules do not use the in- and outputs
+    InOutInfo inOutInfo (false);
+    switch (rmt)
+    {
+        case stiffString:
+            return std::make_shared<StiffString> (rmt, parameters, true, fs, 0, instrument.get(), realTimeMode, inOutInfo, bc);
+        case bar:
+            return std::make_shared<Bar> (rmt, parameters, true, fs, 0, instrument.get(), realTimeMode, inOutInfo, bc);
+        case membrane:
+            return std::make_shared<Membrane> (rmt, parameters, true, fs, 0, instrument.get(), realTimeMode, inOutInfo, bc);
+        case thinPlate:
+            return std::make_shared<ThinPlate> (rmt, parameters, true, fs, 0, instrument.get(), realTimeMode, inOutInfo, bc);
+        case stiffMembrane:
+        default:
+            return std::make_shared<StiffMembrane> (rmt, parameters, true, fs, 0, instrument.get(), realTimeMode, inOutInfo, bc);
+    }
+}
+
+int64 KernelEquivalenceCheck::getUlpDistance (double a, double b)
+{
+    if (a == b)
+        return 0;
+    if (std::isnan (a) || std::isnan (b))
+        return std::numeric_limits<int64>::max();
+    
+    // map the bit patterns onto a monotonic integer line
+    int64 intA, intB;
+    memcpy (&intA, &a, sizeof (double));
+    memcpy (&intB, &b, sizeof (double));
+    if (intA < 0)
+        intA = std::numeric_limits<int64>::min() - intA;
+    if (intB < 0)
+        intB = std::numeric_limits<int64>::min() - intB;
+    return intA > intB ? intA - intB : intB - intA;
+}
+
+String KernelEquivalenceCheck::getTypeString (ResonatorModuleType rmt, BoundaryCondition bc)
+{
+    String bcString = bc == clampedBC ? " clamped" : (bc == simplySupportedBC ? " simply supported" : " free");
+    switch (rmt)
+    {
+        case stiffString:
+            return "Stiff string" + bcString;
+        case bar:
+            return "Bar" + bcString;
+        case membrane:
+            return "Membrane" + bcString;
+        case thinPlate:
+            return "Thin plate" + bcString;
+        case stiffMembrane:
+            return "Stiff membrane" + bcString;
+        default:
+            return "Unknown";
+    }
+}
+
+String KernelEquivalenceCheck::getConnectionTypeString (ConnectionType connectionType)
+{
+    switch (connectionType)
+    {
+        case rigid:
+            return "Rigid";
+        case linearSpring:
+            return "Linear spring";
+        case nonlinearSpring:
+            return "Nonlinear spring";
+        default:
+            return "Unknown";
+    }
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    KernelEquivalenceCheck.h
+    Created: 19 Oct 2026 9:52:03pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/Global.h"
+#include "../../Source/Instrument.h"
+
+/*  Numerical checks of the per-sample update (needs KERNEL_EQUIVALENCE_CHECK, which the test project defines).
+ 
+    Kernels: the calculate function of every resonator module type and boundary condition is compared with its scalar reference (ResonatorModule::calculateReference) on Global::kernelCheckNumCases randomised parameter sets and initial states. Per case, three copies of the module are run:
+        - the variant (calculate) and the reference (calculateReference) run side by side from the same initial state, giving the divergence after Global::kernelCheckNumSteps steps,
+        - the step reference is set to the state of the variant before each of the first Global::kernelCheckNumSingleSteps steps, giving the error of a single step in ULPs.
+    Parameter sets whose grid is not valid are counted as skipped, not as passed. Every module type needs at least one case that ran.
+ 
+    Connection solver: a single connection of every type between two strings and between a string and a thin plate is solved for Global::connectionCheckNumSteps steps after a raised-cos excitation. The forces that solveInteractions applies to both modules need to be equal and opposite, and the displacements afterwards need to satisfy the connection equation (rigid: no relative displacement; springs: the force follows from the spring and damping terms).
+ */
+class KernelEquivalenceCheck : public UnitTest
+{
+public:
+    KernelEquivalenceCheck() : UnitTest ("Kernel equivalence", "ModularVST"), random (Global::kernelCheckSeed) {};
+    
+    void runTest() override;
+    
+private:
+    enum CaseResult
+    {
+        casePassed,
+        caseFailed,
+        caseSkipped
+    };
+    
+    CaseResult runCase (ResonatorModuleType rmt, BoundaryCondition bc);
+    void runConnectionCase (ConnectionType connectionType, ResonatorModuleType rmt);
+    
+    std::shared_ptr<ResonatorModule> createModule (ResonatorModuleType rmt, NamedValueSet parameters, BoundaryCondition bc);
+    
+    static int64 getUlpDistance (double a, double b);
+    static String getTypeString (ResonatorModuleType rmt, BoundaryCondition bc);
+    static String getConnectionTypeString (ConnectionType connectionType);
+    
+    const int fs = Global::kernelCheckSampleRate;
+    Random random;
+    std::unique_ptr<Instrument> instrument; // only used as the change listener of the modules (created in runTest, as it is a component)
+};
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 9:14:27pm
+    Author:  Silvin Willemsen
+
+    Runs the ModularVST unit tests without a host. Run from the root of the
+    repository (the presets and references are found relative to it):
+ 
+        ModularVSTTests                     runs all tests except the preset render check, returns 1 if any failed
+        ModularVSTTests --render-check      also runs the preset render check against the references in Tests/References
+        ModularVSTTests --write-references  (re)writes the preset render references
+ 
+    The preset render check only becomes part of the default run once its references
+    have been rendered from a known-good engine and committed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PresetRenderCheck.h"
+
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser; // the resonator modules are components
+    ArgumentList args (argc, argv);
+    
+    PresetRenderCheck::writeReferences = args.containsOption ("--write-references");
+    
+    StringArray categories ("ModularVST");
+    if (args.containsOption ("--render-check") || PresetRenderCheck::writeReferences)
+        categories.add ("ModularVSTRender");
+    
+    UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    
+    // the results are cleared at the start of every run
+    int numFailures = 0;
+    for (auto& category : categories)
+    {
+        runner.runTestsInCategory (category);
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            numFailures += runner.getResult (i)->failures;
+    }
+    
+    std::cout << (numFailures == 0 ? "All tests passed" : String (numFailures) + " test(s) FAILED") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
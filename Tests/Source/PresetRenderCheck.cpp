@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    PresetRenderCheck.cpp
+    Created: 19 Oct 2026 9:14:27pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#include "PresetRenderCheck.h"
+#include "../../Source/PluginProcessor.h"
+
+bool PresetRenderCheck::writeReferences = false;
+
+static PresetRenderCheck presetRenderCheck;
+
+void PresetRenderCheck::runTest()
+{
+    // the paths are relative to the root of the repository
+    File presetFolder (File::getCurrentWorkingDirectory().getChildFile ("Presets"));
+    File referenceFolder (File::getCurrentWorkingDirectory().getChildFile (Global::renderCheckFolder));
+    if (writeReferences)
+        referenceFolder.createDirectory();
+    
+    Array<File> presetFiles = presetFolder.findChildFiles (File::findFiles, false, "*.xml");
+    presetFiles.sort();
+    
+    beginTest ("Presets");
+    expect (presetFiles.size() > 0, "No presets found in " + presetFolder.getFullPathName());
+    
+    const int fs = Global::renderCheckSampleRate;
+    ModularVSTAudioProcessor parser;
+    for (auto& presetFile : presetFiles)
+    {
+        beginTest (presetFile.getFileNameWithoutExtension());
+        
+        String fileName = presetFile.getFullPathName();
+        std::shared_ptr<const PresetData> presetData;
+        if (parser.parsePreset (presetData, fileName, false) != success || presetData->instruments.size() == 0)
+        {
+            logMessage ("Skipped (could not be loaded or is empty)");
+            continue;
+        }
+        
+        File referenceFile (referenceFolder.getChildFile (presetFile.getFileNameWithoutExtension() + "_" + String (fs) + ".bin"));
+        std::vector<float> reference;
+        double baselineRenderTime = 0.0;
+        bool hasReference = !writeReferences && readReference (referenceFile, reference, baselineRenderTime);
+        if (!hasReference && !writeReferences)
+        {
+            expect (false, "Missing reference " + referenceFile.getFullPathName() + " (run with --write-references)");
+            continue;
+        }
+        
+        for (int b = 0; b < Global::numRenderCheckBlockSizes; ++b)
+        {
+            std::vector<float> output;
+            double renderTime = render (*presetData, Global::renderCheckBlockSizes[b], output);
+            
+            String line = "Block size " + String (Global::renderCheckBlockSizes[b]) + ": ";
+            if (!hasReference)
+            {
+                // the first block size sets the reference for all others
+                hasReference = writeReference (referenceFile, output, renderTime);
+                expect (hasReference, "Could not write " + referenceFile.getFullPathName());
+                reference = output;
+                baselineRenderTime = renderTime;
+                logMessage (line + "reference written, render time " + String (renderTime, 2) + " ms");
+                continue;
+            }
+            
+            float maxAbsError = calcMaxAbsError (output, reference);
+            float spectralDistance = calcSpectralDistance (output, reference);
+            expectLessOrEqual (maxAbsError, Global::renderCheckMaxAbsError, line + "max abs error");
+            expectLessOrEqual (spectralDistance, Global::renderCheckMaxSpectralDistance, line + "spectral distance (dB)");
+            
+            logMessage (line + "max abs error " + String (maxAbsError, 9)
+                        + ", spectral distance " + String (spectralDistance, 4) + " dB"
+                        + ", render time " + String (renderTime, 2) + " ms"
+                        + " (reference " + String (baselineRenderTime, 2) + " ms, "
+                        + String (renderTime / std::max (baselineRenderTime, 1e-6), 2) + "x)");
+        }
+    }
+}
+
+double PresetRenderCheck::render (const PresetData& presetData, int blockSize, std::vector<float>& output)
+{
+    const int fs = Global::renderCheckSampleRate;
+    
+    // a new processor for every render so that everything starts from zero
+    ModularVSTAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (fs, blockSize);
+    processor.prepareToPlay (fs, blockSize);
+    processor.loadPresetFromPresetData (presetData);
+    std::shared_ptr<Instrument> inst = processor.getCurrentlyActiveInstrument();
+    
+    int numSamples = static_cast<int> (Global::renderCheckLength * fs);
+    output.assign (numSamples * 2, 0.0f);
+    AudioBuffer<float> buffer (2, blockSize);
+    MidiBuffer midiMessages;
+    
+    // make sure that the events fall on a block boundary for all block sizes
+    int secondExcitationSample = (numSamples / 2) - ((numSamples / 2) % Global::renderCheckBlockSizes[Global::numRenderCheckBlockSizes - 1]);
+    
+    double startTime = Time::getMillisecondCounterHiRes();
+    for (int blockStart = 0; blockStart < numSamples; blockStart += blockSize)
+    {
+        // excitation script (only the active instrument is processed)
+        if (inst != nullptr && inst->getNumResonatorModules() != 0)
+        {
+            if (blockStart == 0)
+                for (int r = 0; r < inst->getNumResonatorModules(); ++r)
+                    inst->getResonatorPtr (r)->triggerRaisedCos();
+            else if (blockStart == secondExcitationSample)
+                inst->getResonatorPtr (0)->triggerRaisedCos();
+        }
+        
+        int curBlockSize = std::min (blockSize, numSamples - blockStart);
+        buffer.setSize (2, curBlockSize, false, false, true);
+        buffer.clear();
+        processor.processBlock (buffer, midiMessages);
+        
+        for (int i = 0; i < curBlockSize; ++i)
+        {
+            output[2 * (blockStart + i)] = buffer.getSample (0, i);
+            output[2 * (blockStart + i) + 1] = buffer.getSample (1, i);
+        }
+    }
+    double renderTime = Time::getMillisecondCounterHiRes() - startTime;
+    
+    processor.releaseResources();
+    return renderTime;
+}
+
+bool PresetRenderCheck::readReference (const File& file, std::vector<float>& output, double& renderTime)
+{
+    FileInputStream stream (file);
+    if (!stream.openedOk())
+        return false;
+    
+    int numValues = stream.readInt();
+    renderTime = stream.readDouble();
+    if (numValues <= 0 || stream.getNumBytesRemaining() != numValues * static_cast<int64> (sizeof (float)))
+    {
+        logMessage ("Reference " + file.getFileName() + " is corrupt");
+        return false;
+    }
+    output.resize (numValues);
+    stream.read (output.data(), numValues * static_cast<int> (sizeof (float)));
+    return true;
+}
+
+bool PresetRenderCheck::writeReference (const File& file, const std::vector<float>& output, double renderTime)
+{
+    file.deleteFile();
+    FileOutputStream stream (file);
+    if (!stream.openedOk())
+    {
+        logMessage ("Could not write reference " + file.getFullPathName());
+        return false;
+    }
+    stream.writeInt (static_cast<int> (output.size()));
+    stream.writeDouble (renderTime);
+    stream.write (output.data(), output.size() * sizeof (float));
+    return true;
+}
+
+float PresetRenderCheck::calcMaxAbsError (const std::vector<float>& output, const std::vector<float>& reference)
+{
+    if (output.size() != reference.size())
+        return std::numeric_limits<float>::max();
+    
+    float maxAbsError = 0.0f;
+    for (size_t i = 0; i < output.size(); ++i)
+        maxAbsError = std::max (maxAbsError, std::abs (output[i] - reference[i]));
+    return maxAbsError;
+}
+
+float PresetRenderCheck::calcSpectralDistance (const std::vector<float>& output, const std::vector<float>& reference)
+{
+    if (output.size() != reference.size())
+        return std::numeric_limits<float>::max();
+    
+    // RMS difference of the log magnitude spectra (left and right summed) over non-overlapping frames
+    const int frameSize = Global::renderCheckFrameSize;
+    const int numFrames = static_cast<int> (output.size() / 2) / frameSize;
+    std::vector<std::complex<float>> outputFrame (frameSize);
+    std::vector<std::complex<float>> referenceFrame (frameSize);
+    
+    double sumOfSquares = 0.0;
+    int numBins = 0;
+    for (int f = 0; f < numFrames; ++f)
+    {
+        for (int i = 0; i < frameSize; ++i)
+        {
+            int idx = 2 * (f * frameSize + i);
+            float window = 0.5f * (1.0f - cos (2.0f * MathConstants<float>::pi * i / frameSize));
+            outputFrame[i] = window * (output[idx] + output[idx + 1]);
+            referenceFrame[i] = window * (reference[idx] + reference[idx + 1]);
+        }
+        fft (outputFrame);
+        fft (referenceFrame);
+        
+        for (int k = 0; k <= frameSize / 2; ++k)
+        {
+            float diff = Decibels::gainToDecibels (std::abs (outputFrame[k]), Global::renderCheckSpectrumFloor)
+                         - Decibels::gainToDecibels (std::abs (referenceFrame[k]), Global::renderCheckSpectrumFloor);
+            sumOfSquares += diff * diff;
+            ++numBins;
+        }
+    }
+    return numBins == 0 ? 0.0f : static_cast<float> (std::sqrt (sumOfSquares / numBins));
+}
+
+void PresetRenderCheck::fft (std::vector<std::complex<float>>& x)
+{
+    const int n = static_cast<int> (x.size());
+    jassert (isPowerOfTwo (n));
+    
+    // bit reversal
+    for (int i = 1, j = 0; i < n; ++i)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap (x[i], x[j]);
+    }
+    
+    // butterflies
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        std::complex<float> wLen (std::polar (1.0f, -2.0f * MathConstants<float>::pi / len));
+        for (int i = 0; i < n; i += len)
+        {
+            std::complex<float> w (1.0f);
+            for (int j = 0; j < len / 2; ++j)
+            {
+                std::complex<float> a = x[i + j];
+                std::complex<float> b = x[i + j + len / 2] * w;
+                x[i + j] = a + b;
+                x[i + j + len / 2] = a - b;
+                w *= wLen;
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    PresetRenderCheck.h
+    Created: 19 Oct 2026 9:14:27pm
+    Author:  Silvin Willemsen
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/Global.h"
+#include "../../Source/PresetData.h"
+
+#include <complex>
+
+/*  Golden-output test over all XML presets in the preset folder (part of ModularVSTTests, only run with --render-check or --write-references).
+ 
+    Every preset is rendered through ModularVSTAudioProcessor::processBlock at Global::renderCheckSampleRate for each of Global::renderCheckBlockSizes, with a fixed excitation script (a raised cosine on all resonators of the active instrument at the start and on its first resonator halfway). Every render is compared with the reference in Global::renderCheckFolder (max abs error and log-spectral distance). The render time is reported next to the one stored with the reference, but does not make the test fail.
+ 
+    A missing reference makes the test fail. Run ModularVSTTests with --write-references to (re)write the references from the first block size, e.g., to accept a change in the sound, and commit them.
+ */
+class PresetRenderCheck : public UnitTest
+{
+public:
+    PresetRenderCheck() : UnitTest ("Preset render", "ModularVSTRender") {};
+    
+    void runTest() override;
+    
+    static bool writeReferences; // set from the command line
+    
+private:
+    // Renders the preset (interleaved stereo) and returns the render time in ms
+    double render (const PresetData& presetData, int blockSize, std::vector<float>& output);
+    
+    bool readReference (const File& file, std::vector<float>& output, double& renderTime);
+    bool writeReference (const File& file, const std::vector<float>& output, double renderTime);
+    
+    static float calcMaxAbsError (const std::vector<float>& output, const std::vector<float>& reference);
+    static float calcSpectralDistance (const std::vector<float>& output, const std::vector<float>& reference);
+    static void fft (std::vector<std::complex<float>>& x); // in place, size must be a power of two
+};